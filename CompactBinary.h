@@ -0,0 +1,268 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// minimal Compact Binary v1/v2 primitives for the fixed Settings and State schemas
+// https://microsoft.github.io/bond/reference/cpp/compact__binary_8h_source.html
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		namespace CompactBinary
+		{
+			constexpr uint16_t Magic = 0x4243; // "CB"
+
+			// subset of bond::BondDataType used by the schemas
+			namespace Type
+			{
+				constexpr uint8_t Stop		= 0;
+				constexpr uint8_t StopBase	= 1;
+				constexpr uint8_t Bool		= 2;
+				constexpr uint8_t UInt64	= 6;
+				constexpr uint8_t Struct	= 10;
+				constexpr uint8_t Int8		= 14;
+				constexpr uint8_t Int16		= 15;
+				constexpr uint8_t Int32		= 16;
+			} // namespace Type
+
+			class Reader
+			{
+			public:
+				Reader(const uint8_t* data, const size_t size, const uint16_t version) noexcept
+					: _data(data), _end(data + size), _version(version) {};
+
+				const uint16_t getVersion() const noexcept { return _version; }
+
+				const bool readByte(uint8_t& value) noexcept
+				{
+					if (_data >= _end)
+						return false;
+					value = *(_data++);
+					return true;
+				}
+
+				const bool readVarUInt(uint64_t& value) noexcept
+				{
+					value = 0;
+					for (uint8_t shift = 0; shift < 64; shift += 7) {
+						uint8_t byte;
+						if (!readByte(byte))
+							return false;
+						value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+						if ((byte & 0x80) == 0)
+							return true;
+					}
+					return false;
+				}
+
+				const bool readVarInt(int64_t& value) noexcept
+				{
+					uint64_t zigzag;
+					if (!readVarUInt(zigzag))
+						return false;
+					value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+					return true;
+				}
+
+				const bool readFieldBegin(uint8_t& type, uint16_t& id) noexcept
+				{
+					uint8_t byte;
+					if (!readByte(byte))
+						return false;
+					type = byte & 0x1f;
+					id = byte >> 5;
+					if (id == 6) {
+						if (!readByte(byte))
+							return false;
+						id = byte;
+					}
+					else if (id == 7) {
+						uint8_t hi;
+						if (!readByte(byte) || !readByte(hi))
+							return false;
+						id = static_cast<uint16_t>(byte | (hi << 8));
+					}
+					return true;
+				}
+
+				// field values, fail on a type mismatch so the caller can fall back to bond
+				const bool readValue(const uint8_t type, bool& value) noexcept
+				{
+					uint8_t byte;
+					if (type != Type::Bool || !readByte(byte))
+						return false;
+					value = (byte != 0);
+					return true;
+				}
+
+				const bool readValue(const uint8_t type, int8_t& value) noexcept
+				{
+					uint8_t byte;
+					if (type != Type::Int8 || !readByte(byte))
+						return false;
+					value = static_cast<int8_t>(byte);
+					return true;
+				}
+
+				const bool readValue(const uint8_t type, int16_t& value) noexcept
+				{
+					int64_t v;
+					if (type != Type::Int16 || !readVarInt(v) || v < INT16_MIN || v > INT16_MAX)
+						return false;
+					value = static_cast<int16_t>(v);
+					return true;
+				}
+
+				const bool readValue(const uint8_t type, int32_t& value) noexcept
+				{
+					int64_t v;
+					if (type != Type::Int32 || !readVarInt(v) || v < INT32_MIN || v > INT32_MAX)
+						return false;
+					value = static_cast<int32_t>(v);
+					return true;
+				}
+
+				const bool readValue(const uint8_t type, uint64_t& value) noexcept
+				{
+					return type == Type::UInt64 && readVarUInt(value);
+				}
+
+				// v2 structs are prefixed with their length, the struct must end within it
+				const bool readStructBegin(const uint8_t*& structEnd) noexcept
+				{
+					structEnd = _end;
+					if (_version < 2)
+						return true;
+					uint64_t length;
+					if (!readVarUInt(length) || length > static_cast<uint64_t>(_end - _data))
+						return false;
+					structEnd = _data + length;
+					return true;
+				}
+
+				const bool readStructEnd(const uint8_t* structEnd) noexcept
+				{
+					if (_version < 2)
+						return true;
+					// anything left in the struct was not understood
+					return _data == structEnd;
+				}
+			private:
+				const uint8_t*	_data;
+				const uint8_t*	_end;
+				const uint16_t	_version;
+			}; // class Reader
+
+			// fixed size scratch for one struct, the schemas encode in well under a hundred bytes
+			class Writer
+			{
+			public:
+				static constexpr size_t Capacity = 128;
+
+				Writer(const uint16_t version) noexcept : _version(version) {};
+
+				const uint16_t getVersion() const noexcept { return _version; }
+				const uint8_t* data() const noexcept { return _data; }
+				const size_t size() const noexcept { return _size; }
+				const bool good() const noexcept { return _good; }
+
+				void writeByte(const uint8_t value) noexcept
+				{
+					if (_size < Capacity)
+						_data[_size++] = value;
+					else
+						_good = false;
+				}
+
+				void writeBytes(const uint8_t* data, const size_t size) noexcept
+				{
+					if (_size + size <= Capacity) {
+						memcpy(_data + _size, data, size);
+						_size += size;
+					}
+					else
+						_good = false;
+				}
+
+				void writeVarUInt(uint64_t value) noexcept
+				{
+					while (value >= 0x80) {
+						writeByte(static_cast<uint8_t>(value | 0x80));
+						value >>= 7;
+					}
+					writeByte(static_cast<uint8_t>(value));
+				}
+
+				void writeVarInt(const int64_t value) noexcept
+				{
+					writeVarUInt((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+				}
+
+				void writeFieldBegin(const uint8_t type, const uint16_t id) noexcept
+				{
+					if (id <= 5)
+						writeByte(static_cast<uint8_t>(type | (id << 5)));
+					else if (id <= 0xff) {
+						writeByte(static_cast<uint8_t>(type | (6 << 5)));
+						writeByte(static_cast<uint8_t>(id));
+					}
+					else {
+						writeByte(static_cast<uint8_t>(type | (7 << 5)));
+						writeByte(static_cast<uint8_t>(id));
+						writeByte(static_cast<uint8_t>(id >> 8));
+					}
+				}
+
+				void writeField(const uint16_t id, const bool value) noexcept
+				{
+					writeFieldBegin(Type::Bool, id);
+					writeByte(value ? 1 : 0);
+				}
+
+				void writeField(const uint16_t id, const int8_t value) noexcept
+				{
+					writeFieldBegin(Type::Int8, id);
+					writeByte(static_cast<uint8_t>(value));
+				}
+
+				void writeField(const uint16_t id, const int16_t value) noexcept
+				{
+					writeFieldBegin(Type::Int16, id);
+					writeVarInt(value);
+				}
+
+				void writeField(const uint16_t id, const int32_t value) noexcept
+				{
+					writeFieldBegin(Type::Int32, id);
+					writeVarInt(value);
+				}
+
+				void writeField(const uint16_t id, const uint64_t value) noexcept
+				{
+					writeFieldBegin(Type::UInt64, id);
+					writeVarUInt(value);
+				}
+
+				void writeStructEnd() noexcept
+				{
+					writeByte(Type::Stop);
+				}
+
+				// appends a complete struct body, v2 prefixes it with its length
+				void writeStruct(const Writer& body) noexcept
+				{
+					if (!body.good())
+						_good = false;
+					if (_version >= 2)
+						writeVarUInt(body.size());
+					writeBytes(body.data(), body.size());
+				}
+			private:
+				uint8_t			_data[Capacity];
+				size_t			_size{ 0 };
+				bool			_good{ true };
+				const uint16_t	_version;
+			}; // class Writer
+		} // namespace CompactBinary
+	} // namespace Registry
+} // namespace NightLightLibrary
@@ -0,0 +1,117 @@
+#include "stdafx.h"
+#include "Corpus.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		namespace Corpus
+		{
+			// file layout: Magic, Version, reserved (uint16), then entries of
+			// subkey size (uint16), data size (uint32), subkey, data
+			static std::atomic<bool> capturing{ false };
+			static std::mutex mutex;
+			static std::ofstream file; // guarded by mutex
+
+			const bool startCapture(const char* path)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (file.is_open())
+					file.close();
+				{
+					// appending needs a file of this version
+					std::ifstream existing(path, std::ios::binary);
+					uint32_t magic = 0;
+					uint16_t version = 0;
+					if (existing && existing.read(reinterpret_cast<char*>(&magic), sizeof(magic)).read(reinterpret_cast<char*>(&version), sizeof(version))
+						&& (magic != Magic || version != Version))
+						return false;
+				}
+				file.open(path, std::ios::binary | std::ios::app);
+				if (!file)
+					return false;
+				file.seekp(0, std::ios::end);
+				if (file.tellp() == std::streampos(0)) {
+					const uint16_t reserved = 0;
+					file.write(reinterpret_cast<const char*>(&Magic), sizeof(Magic));
+					file.write(reinterpret_cast<const char*>(&Version), sizeof(Version));
+					file.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+				}
+				capturing = file.good();
+				return capturing;
+			}
+
+			void stopCapture() noexcept
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				capturing = false;
+				file.close();
+			}
+
+			const bool isCapturing() noexcept
+			{
+				return capturing.load(std::memory_order_relaxed);
+			}
+
+			void capture(const LPCSTR subKey, const uint8_t* data, const size_t size)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!capturing)
+					return;
+				const uint16_t subKeySize = static_cast<uint16_t>(std::strlen(subKey));
+				const uint32_t dataSize = static_cast<uint32_t>(size);
+				file.write(reinterpret_cast<const char*>(&subKeySize), sizeof(subKeySize));
+				file.write(reinterpret_cast<const char*>(&dataSize), sizeof(dataSize));
+				file.write(subKey, subKeySize);
+				file.write(reinterpret_cast<const char*>(data), dataSize);
+				file.flush();
+				if (!file)
+					capturing = false;
+			}
+
+			const bool read(const char* path, std::vector<Entry>& entries)
+			{
+				std::ifstream input(path, std::ios::binary);
+				uint32_t magic = 0;
+				uint16_t version = 0;
+				uint16_t reserved = 0;
+				input.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+				input.read(reinterpret_cast<char*>(&version), sizeof(version));
+				input.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+				if (!input || magic != Magic || version != Version)
+					return false;
+				// the sizes are untrusted, nothing is allocated past what the file still holds
+				const std::streampos start = input.tellg();
+				input.seekg(0, std::ios::end);
+				const std::streampos end = input.tellg();
+				input.seekg(start);
+				if (start < 0 || end < start || !input)
+					return false;
+				uint64_t remaining = static_cast<uint64_t>(end - start);
+				for (;;) {
+					uint16_t subKeySize;
+					uint32_t dataSize;
+					if (!input.read(reinterpret_cast<char*>(&subKeySize), sizeof(subKeySize)))
+						return input.eof() && input.gcount() == 0;
+					if (!input.read(reinterpret_cast<char*>(&dataSize), sizeof(dataSize)))
+						return false;
+					remaining -= std::min<uint64_t>(remaining, sizeof(subKeySize) + sizeof(dataSize));
+					if (static_cast<uint64_t>(subKeySize) + dataSize > remaining)
+						return false;
+					remaining -= static_cast<uint64_t>(subKeySize) + dataSize;
+					Entry entry;
+					entry.subKey.resize(subKeySize);
+					entry.data.resize(dataSize);
+					if (!input.read(&entry.subKey[0], subKeySize) || !input.read(reinterpret_cast<char*>(entry.data.data()), dataSize))
+						return false;
+					entries.push_back(std::move(entry));
+				}
+			}
+		} // namespace Corpus
+	} // namespace Registry
+} // namespace NightLightLibrary
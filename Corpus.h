@@ -0,0 +1,33 @@
+#pragma once
+#include "Platform.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		// versioned file of raw values as read by load(): header, metadata and payload
+		namespace Corpus
+		{
+			constexpr uint32_t Magic = 0x43424c4e; // "NLBC"
+			constexpr uint16_t Version = 1;
+
+			struct Entry
+			{
+				std::string				subKey;
+				std::vector<uint8_t>	data;
+			}; // struct Entry
+
+			// appends every value load() reads to path until stopCapture(), false when the file cannot be used
+			const bool startCapture(const char* path);
+			void stopCapture() noexcept;
+			const bool isCapturing() noexcept;
+			void capture(const LPCSTR subKey, const uint8_t* data, const size_t size);
+
+			// false when the file is missing, of another version or truncated, entries read until then are kept
+			const bool read(const char* path, std::vector<Entry>& entries);
+		} // namespace Corpus
+	} // namespace Registry
+} // namespace NightLightLibrary
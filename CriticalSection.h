@@ -0,0 +1,23 @@
+#pragma once
+#include "Platform.h"
+
+namespace NightLightLibrary
+{
+	// recursive lock whose lock() cannot fail, for the noexcept setters and the publishing they do
+	// std::recursive_mutex::lock may throw, which terminates from a noexcept function
+	// Platform.h backs it with a recursive pthread mutex outside Windows
+	class CriticalSection
+	{
+	public:
+		CriticalSection() noexcept { ::InitializeCriticalSection(&_section); }
+		~CriticalSection() { ::DeleteCriticalSection(&_section); }
+		CriticalSection(const CriticalSection&) = delete;
+		CriticalSection& operator=(const CriticalSection&) = delete;
+
+		void lock() noexcept { ::EnterCriticalSection(&_section); }
+		const bool try_lock() noexcept { return ::TryEnterCriticalSection(&_section) != FALSE; }
+		void unlock() noexcept { ::LeaveCriticalSection(&_section); }
+	private:
+		CRITICAL_SECTION _section;
+	}; // class CriticalSection
+} // namespace NightLightLibrary
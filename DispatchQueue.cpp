@@ -0,0 +1,203 @@
+#include "stdafx.h"
+#include "DispatchQueue.h"
+#include "Metrics.h"
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		static_assert((DispatchQueue::Capacity & (DispatchQueue::Capacity - 1)) == 0, "Capacity must be a power of two");
+
+		static thread_local bool callbackThread = false;
+
+		DispatchQueue& DispatchQueue::instance()
+		{
+			static DispatchQueue queue;
+			return queue;
+		}
+
+		DispatchQueue::DispatchQueue() : _cells(new Cell[Capacity])
+		{
+			for (size_t i = 0; i < Capacity; i++)
+				_cells[i].sequence.store(i, std::memory_order_relaxed);
+			// started here rather than by post() so posting never takes a lock to start it
+			_thread = std::thread(&DispatchQueue::run, this);
+		}
+
+		DispatchQueue::~DispatchQueue()
+		{
+			shutdown();
+			if (_thread.joinable())
+				_thread.detach(); // destroyed from a task, the thread exits once it returns
+		}
+
+		void DispatchQueue::shutdown() noexcept
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+			_condition.notify_one();
+			// unlike Executor tasks, queued callbacks are dropped, what they reach may already be gone
+			if (_thread.joinable() && !isCallbackThread())
+				_thread.join();
+			discard();
+		}
+
+		const bool DispatchQueue::isCallbackThread() noexcept
+		{
+			return callbackThread;
+		}
+
+		void DispatchQueue::post(std::function<void()> task, std::atomic<bool>* queued)
+		{
+			if (_stopping.load(std::memory_order_relaxed))
+				return;
+			const bool coalesce = queued != nullptr && _overflow.load(std::memory_order_relaxed) == Overflow::CoalescePerKey;
+			Metrics::WatchMetrics& metrics = Metrics::watch();
+			if (coalesce && queued->exchange(true)) {
+				metrics.coalescedCallbacks.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			Entry entry;
+			entry.task = std::move(task);
+			entry.queued = coalesce ? queued : nullptr;
+			entry.posted = std::chrono::steady_clock::now();
+			// counted first so the depth never goes below zero while the callback thread pops
+			const uint64_t depth = _depth.fetch_add(1) + 1;
+			metrics.queueDepth.fetch_add(1, std::memory_order_relaxed);
+			uint64_t maxDepth = metrics.maxQueueDepth.load(std::memory_order_relaxed);
+			while (depth > maxDepth && !metrics.maxQueueDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) {}
+			while (!tryPush(entry)) {
+				Entry oldest;
+				if (tryPop(oldest)) {
+					_depth.fetch_sub(1);
+					metrics.queueDepth.fetch_sub(1, std::memory_order_relaxed);
+					metrics.droppedCallbacks.fetch_add(1, std::memory_order_relaxed);
+					if (oldest.queued != nullptr)
+						oldest.queued->store(false);
+				}
+			}
+			// pairs with run() setting _sleeping before it checks _depth
+			if (_sleeping.load()) {
+				std::lock_guard<std::mutex> lock(_mutex);
+				_condition.notify_one();
+			}
+		}
+
+		const Overflow DispatchQueue::getOverflow() const noexcept
+		{
+			return _overflow;
+		}
+
+		void DispatchQueue::setOverflow(const Overflow overflow) noexcept
+		{
+			_overflow = overflow;
+		}
+
+		const size_t DispatchQueue::getDepth() const noexcept
+		{
+			return _depth;
+		}
+
+		const size_t DispatchQueue::getMaxDepth() const noexcept
+		{
+			return static_cast<size_t>(Metrics::watch().maxQueueDepth.load());
+		}
+
+		const uint64_t DispatchQueue::getDroppedCount() const noexcept
+		{
+			return Metrics::watch().droppedCallbacks;
+		}
+
+		const uint64_t DispatchQueue::getCoalescedCount() const noexcept
+		{
+			return Metrics::watch().coalescedCallbacks;
+		}
+
+		const bool DispatchQueue::tryPush(Entry& entry) noexcept
+		{
+			// http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+			Cell* cell;
+			size_t position = _pushPosition.load(std::memory_order_relaxed);
+			for (;;) {
+				cell = &_cells[position & (Capacity - 1)];
+				const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+				if (difference == 0) {
+					if (_pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (difference < 0)
+					return false; // full
+				else
+					position = _pushPosition.load(std::memory_order_relaxed);
+			}
+			cell->entry = std::move(entry);
+			cell->sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		const bool DispatchQueue::tryPop(Entry& entry) noexcept
+		{
+			Cell* cell;
+			size_t position = _popPosition.load(std::memory_order_relaxed);
+			for (;;) {
+				cell = &_cells[position & (Capacity - 1)];
+				const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+				if (difference == 0) {
+					if (_popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (difference < 0)
+					return false; // empty
+				else
+					position = _popPosition.load(std::memory_order_relaxed);
+			}
+			entry = std::move(cell->entry);
+			cell->entry = Entry(); // releases what the task captured
+			cell->sequence.store(position + Capacity, std::memory_order_release);
+			return true;
+		}
+
+		void DispatchQueue::discard() noexcept
+		{
+			Metrics::WatchMetrics& metrics = Metrics::watch();
+			Entry entry;
+			while (tryPop(entry)) {
+				_depth.fetch_sub(1);
+				metrics.queueDepth.fetch_sub(1, std::memory_order_relaxed);
+				if (entry.queued != nullptr)
+					entry.queued->store(false);
+				entry = Entry();
+			}
+		}
+
+		void DispatchQueue::run()
+		{
+			callbackThread = true;
+			Metrics::WatchMetrics& metrics = Metrics::watch();
+			Entry entry;
+			for (;;) {
+				while (!_stopping.load(std::memory_order_relaxed) && tryPop(entry)) {
+					_depth.fetch_sub(1);
+					metrics.queueDepth.fetch_sub(1, std::memory_order_relaxed);
+					// a notification arriving while the task runs queues a new one
+					if (entry.queued != nullptr)
+						entry.queued->store(false);
+					metrics.dispatchLag.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - entry.posted).count()));
+					entry.task();
+					entry = Entry();
+				}
+				std::unique_lock<std::mutex> lock(_mutex);
+				_sleeping = true;
+				_condition.wait(lock, [this]() { return _stopping || _depth.load() > 0; });
+				_sleeping = false;
+				if (_stopping)
+					return;
+			}
+		}
+	} // namespace Registry
+} // namespace NightLightLibrary
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		// what post() does when the queue is full or a key is already queued
+		enum class Overflow
+		{
+			DropOldest,		// every notification is queued, the oldest one is dropped to make room
+			CoalescePerKey	// a key has at most one queued callback, the oldest one is dropped if still full
+		}; // enum class Overflow
+
+		// process-wide bounded queue between the watcher threads and a single callback thread
+		// so a slow callback never delays re-arming a watch
+		// post() is lock-free unless it has to wake the callback thread
+		class DispatchQueue
+		{
+		public:
+			static constexpr size_t Capacity = 256; // power of two
+
+			static DispatchQueue& instance();
+			// calls shutdown(), which can deadlock on the loader lock when run from a DLL's static destructors
+			~DispatchQueue();
+			DispatchQueue(const DispatchQueue&) = delete;
+			DispatchQueue& operator=(const DispatchQueue&) = delete;
+
+			// runs task on the callback thread
+			// with CoalescePerKey, a task posted while queued is set is merged into the one already queued
+			// queued is cleared before that task runs and must stay valid until then, the task usually owns it
+			void post(std::function<void()> task, std::atomic<bool>* queued = nullptr);
+			// stops the callback thread, waiting for a running task, queued and later tasks are discarded
+			// hosts unloading the library call it first, through Registry::shutdown(), from a single thread
+			// from a task, it returns at once and the thread exits after that task
+			void shutdown() noexcept;
+			// true on the thread running the tasks
+			static const bool isCallbackThread() noexcept;
+
+			const Overflow getOverflow() const noexcept;
+			void setOverflow(const Overflow overflow) noexcept;
+
+			// tasks waiting for the callback thread, posts in progress included
+			// the counters live in Metrics::watch()
+			const size_t getDepth() const noexcept;
+			const size_t getMaxDepth() const noexcept;
+			const uint64_t getDroppedCount() const noexcept;
+			const uint64_t getCoalescedCount() const noexcept;
+		private:
+			struct Entry
+			{
+				std::function<void()>					task;
+				std::atomic<bool>*						queued{ nullptr };
+				std::chrono::steady_clock::time_point	posted;
+			}; // struct Entry
+
+			// bounded MPMC ring, producers also pop to drop the oldest entry
+			struct Cell
+			{
+				std::atomic<size_t>	sequence;
+				Entry				entry;
+			}; // struct Cell
+
+			DispatchQueue();
+
+			std::unique_ptr<Cell[]>		_cells;
+			alignas(64) std::atomic<size_t>	_pushPosition{ 0 };
+			alignas(64) std::atomic<size_t>	_popPosition{ 0 };
+			std::atomic<size_t>			_depth{ 0 };
+			std::atomic<Overflow>		_overflow{ Overflow::CoalescePerKey };
+
+			std::mutex					_mutex;
+			std::condition_variable		_condition;
+			std::atomic<bool>			_sleeping{ false };
+			std::atomic<bool>			_stopping{ false };	// set under _mutex
+			std::thread					_thread;
+
+			// entry is moved from only on success
+			const bool tryPush(Entry& entry) noexcept;
+			const bool tryPop(Entry& entry) noexcept;
+			void discard() noexcept;
+			void run();
+		}; // class DispatchQueue
+	} // namespace Registry
+} // namespace NightLightLibrary
@@ -0,0 +1,49 @@
+#include "stdafx.h"
+#include "Executor.h"
+
+namespace NightLightLibrary
+{
+	Executor& Executor::instance()
+	{
+		static Executor executor;
+		return executor;
+	}
+
+	Executor::~Executor()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_condition.notify_one();
+		// queued tasks still run, their futures would otherwise never complete
+		if (_thread.joinable())
+			_thread.join();
+	}
+
+	void Executor::post(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.push_back(std::move(task));
+			if (!_thread.joinable())
+				_thread = std::thread(&Executor::run, this);
+		}
+		_condition.notify_one();
+	}
+
+	void Executor::run()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		for (;;) {
+			_condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+			if (_tasks.empty())
+				return; // stopping
+			std::function<void()> task = std::move(_tasks.front());
+			_tasks.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+} // namespace NightLightLibrary
@@ -0,0 +1,33 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace NightLightLibrary
+{
+	// process-wide worker running the library's background work in submission order
+	// tasks must not wait for work queued after them, there is a single thread
+	class Executor
+	{
+	public:
+		static Executor& instance();
+		~Executor();
+		Executor(const Executor&) = delete;
+		Executor& operator=(const Executor&) = delete;
+
+		// the thread starts with the first task
+		void post(std::function<void()> task);
+	private:
+		Executor() = default;
+
+		std::mutex				_mutex;
+		std::condition_variable	_condition;
+		std::deque<std::function<void()>> _tasks;
+		bool					_stopping{ false };
+		std::thread				_thread;
+
+		void run();
+	}; // class Executor
+} // namespace NightLightLibrary
@@ -0,0 +1,362 @@
+#include "stdafx.h"
+#include "FileWatcher.h"
+#include "DispatchQueue.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#ifdef _DEBUG
+#include <iostream>
+#endif // _DEBUG
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif // _WIN32
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		FileWatcher::FileWatcher(const std::string& directory, const PathOf& pathOf, const Polling& polling)
+			: _directory(directory), _pathOf(pathOf), _polling(polling), _target(std::make_shared<Target>())
+		{
+			DispatchQueue::instance(); // outlives the watcher
+		}
+
+		FileWatcher::~FileWatcher()
+		{
+			stop();
+		}
+
+		const bool FileWatcher::isWatching() const noexcept
+		{
+			return _thread.joinable();
+		}
+
+		void FileWatcher::start(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback)
+		{
+			if (isWatching() || subKeys.size() < 1)
+				return;
+			_files.clear();
+			for (const LPCSTR& subKey : subKeys) {
+				File file;
+				file.subKey = subKey;
+				file.queued = std::make_shared<std::atomic<bool>>(false);
+				file.path = _pathOf(subKey);
+				file.name = file.path.substr(file.path.find_last_of("/\\") + 1);
+				scan(file); // changes are reported against the content at start
+				_files.push_back(file);
+			}
+			_callback = callback;
+			_stopping = false;
+			openNotify();
+			_thread = std::thread(&FileWatcher::watchLoop, this);
+		}
+
+		void FileWatcher::stop() noexcept
+		{
+			if (!_thread.joinable())
+				return;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+			_wake.notify_all();
+#ifdef __linux__
+			const char wake = 0;
+			if (_wakePipe[1] >= 0 && ::write(_wakePipe[1], &wake, sizeof(wake)) < 0) {
+				// the pipe is only closed after the thread is joined, a full pipe already wakes it
+			}
+#endif // __linux__
+			_thread.join();
+			{
+				// waits for a running callback, queued ones are dropped
+				std::lock_guard<std::recursive_mutex> lock(_target->mutex);
+				_target->generation++;
+			}
+			closeNotify();
+			_files.clear();
+		}
+
+		void FileWatcher::setCoalescing(const Coalescing& coalescing) noexcept
+		{
+			_coalescing = coalescing;
+		}
+
+		void FileWatcher::setImmediate(const bool immediate) noexcept
+		{
+			_immediate = immediate;
+		}
+
+		const bool FileWatcher::isPaused() const noexcept
+		{
+			return _paused;
+		}
+
+		void FileWatcher::pause() noexcept
+		{
+			_paused = true;
+		}
+
+		void FileWatcher::resume() noexcept
+		{
+			_paused = false;
+		}
+
+		const bool FileWatcher::isNotified() const noexcept
+		{
+			return _notify >= 0;
+		}
+
+		const uint64_t FileWatcher::getWakeupCount() const noexcept
+		{
+			return _wakeups;
+		}
+
+		const uint64_t FileWatcher::getCallbackCount() const noexcept
+		{
+			return _target->callbacks;
+		}
+
+		const bool FileWatcher::readStamp(const std::string& path, Stamp& stamp)
+		{
+#ifdef _WIN32
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			if (!::GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+				return false;
+			stamp.mtime = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+			stamp.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+			stamp.id = 0; // not exposed without opening the file, mtime and size catch the swap
+#else // _WIN32
+			struct stat status;
+			if (::stat(path.c_str(), &status) != 0)
+				return false;
+			stamp.mtime = static_cast<uint64_t>(status.st_mtim.tv_sec) * 1000000000 + static_cast<uint64_t>(status.st_mtim.tv_nsec);
+			stamp.size = static_cast<uint64_t>(status.st_size);
+			stamp.id = static_cast<uint64_t>(status.st_ino);
+#endif // _WIN32
+			stamp.exists = true;
+			return true;
+		}
+
+		const bool FileWatcher::scan(File& file)
+		{
+			Stamp stamp;
+			readStamp(file.path, stamp);
+			if (stamp.exists == file.stamp.exists && (!stamp.exists ||
+				(stamp.mtime == file.stamp.mtime && stamp.size == file.stamp.size && stamp.id == file.stamp.id)))
+				return false;
+			if (stamp.exists) {
+				// metadata moved, only a different content is a change
+				std::ifstream input(file.path, std::ios::binary);
+				if (!input)
+					return false; // replaced again meanwhile, the next event or poll sees it
+				const std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+				if (input.bad())
+					return false;
+				stamp.hash = hashData(data.data(), data.size());
+			}
+			const bool changed = stamp.exists != file.stamp.exists || stamp.hash != file.stamp.hash;
+			file.stamp = stamp;
+			return changed;
+		}
+
+		const bool FileWatcher::openNotify()
+		{
+#ifdef __linux__
+			// files are written aside and renamed in, so the directory is watched rather than the files
+			const int notify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (notify < 0)
+				return false;
+			constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+			if (::inotify_add_watch(notify, _directory.c_str(), mask) < 0 || ::pipe2(_wakePipe, O_CLOEXEC) != 0) {
+				::close(notify);
+				return false;
+			}
+			_notify = notify;
+			return true;
+#else // __linux__
+			return false;
+#endif // __linux__
+		}
+
+		void FileWatcher::closeNotify() noexcept
+		{
+#ifdef __linux__
+			const int notify = _notify.exchange(-1);
+			if (notify >= 0)
+				::close(notify);
+			for (int& end : _wakePipe) {
+				if (end >= 0)
+					::close(end);
+				end = -1;
+			}
+#endif // __linux__
+		}
+
+		const bool FileWatcher::wait(const Clock::time_point until)
+		{
+#ifdef __linux__
+			if (_notify >= 0) {
+				int timeout = -1;
+				if (until != Clock::time_point::max()) {
+					const Clock::duration remaining = std::max(until - Clock::now(), Clock::duration::zero());
+					// rounded up so a due deadline is not missed by a sub-millisecond early wake
+					timeout = static_cast<int>(std::min<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+						remaining + std::chrono::milliseconds(1) - Clock::duration(1)).count(), INT32_MAX));
+				}
+				pollfd fds[2] = { { _notify, POLLIN, 0 }, { _wakePipe[0], POLLIN, 0 } };
+				::poll(fds, 2, timeout);
+				std::lock_guard<std::mutex> lock(_mutex);
+				return !_stopping;
+			}
+#endif // __linux__
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (until == Clock::time_point::max())
+				_wake.wait(lock, [this]() { return _stopping; });
+			else
+				_wake.wait_until(lock, until, [this]() { return _stopping; });
+			return !_stopping;
+		}
+
+		void FileWatcher::readEvents(std::vector<File*>& files)
+		{
+#ifdef __linux__
+			alignas(inotify_event) char buffer[4096];
+			for (;;) {
+				const ssize_t length = ::read(_notify, buffer, sizeof(buffer));
+				if (length <= 0)
+					return; // drained
+				for (ssize_t offset = 0; offset < length;) {
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+					offset += sizeof(inotify_event) + event->len;
+					if (event->mask & (IN_Q_OVERFLOW | IN_IGNORED)) {
+						// events were lost, or the directory went away and polling takes over
+						for (File& file : _files)
+							files.push_back(&file);
+						if (event->mask & IN_IGNORED) {
+							::close(_notify.exchange(-1));
+							return;
+						}
+						continue;
+					}
+					if (event->len == 0)
+						continue;
+					for (File& file : _files) {
+						if (file.name == event->name)
+							files.push_back(&file);
+					}
+				}
+			}
+#else // __linux__
+			UNREFERENCED_PARAMETER(files);
+#endif // __linux__
+		}
+
+		void FileWatcher::schedule(File& file, const Clock::time_point now)
+		{
+			if (_immediate) {
+				// stop() joins this thread, so the callback cannot outlive the watcher
+				if (!_paused) {
+					_target->callbacks++;
+					_callback(file.subKey.c_str());
+				}
+				return;
+			}
+			if (!file.pending) {
+				file.notified = now;
+				file.burstStart = now;
+			}
+			if (_coalescing.quietPeriod == 0) {
+				post(file);
+				return;
+			}
+			// (re)start the quiet period, bounded by the burst's max delay
+			file.pending = true;
+			file.deadline = now + std::chrono::milliseconds(_coalescing.quietPeriod);
+			if (_coalescing.maxDelay != 0)
+				file.deadline = std::min(file.deadline, file.burstStart + std::chrono::milliseconds(_coalescing.maxDelay));
+		}
+
+		void FileWatcher::post(File& file)
+		{
+			file.pending = false;
+			if (_paused)
+				return;
+			// the task only holds what outlives the watcher, stop() retires it through the generation
+			const std::shared_ptr<Target> target = _target;
+			const uint64_t generation = target->generation;
+			const std::shared_ptr<std::atomic<bool>> queued = file.queued;
+			const std::string subKey = file.subKey;
+			const std::function<void(LPCSTR)> callback = _callback;
+			const Clock::time_point notified = file.notified;
+			DispatchQueue::instance().post([target, generation, queued, subKey, callback, notified]() {
+				std::lock_guard<std::recursive_mutex> lock(target->mutex);
+				if (target->generation != generation)
+					return;
+#ifdef _DEBUG
+				std::cout << "File changed : [" << subKey << "]" << std::endl;
+#endif // _DEBUG
+				target->callbacks++;
+				Metrics::WatchMetrics& metrics = Metrics::watch();
+				metrics.fileCallbacks++;
+				metrics.notifyToCallback.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+					Clock::now() - notified).count()));
+				Metrics::ScopedTimer timer(metrics.callback);
+				callback(subKey.c_str());
+			}, queued.get());
+		}
+
+		void FileWatcher::watchLoop()
+		{
+			const ULONGLONG minInterval = std::max<ULONGLONG>(_polling.minInterval, 1);
+			const ULONGLONG maxInterval = std::max(_polling.maxInterval, minInterval);
+			ULONGLONG interval = minInterval;
+			Clock::time_point nextPoll = Clock::now() + std::chrono::milliseconds(interval);
+			std::vector<File*> changed;
+			for (;;) {
+				// sleep until the next poll or the earliest coalesced callback is due
+				Clock::time_point until = _notify >= 0 ? Clock::time_point::max() : nextPoll;
+				for (const File& file : _files) {
+					if (file.pending)
+						until = std::min(until, file.deadline);
+				}
+				if (!wait(until))
+					return;
+				_wakeups++;
+				if (!_immediate) // internal watchers, such as the RecordCache ones, are not what the metrics describe
+					Metrics::watch().fileWakeups++;
+
+				const Clock::time_point now = Clock::now();
+				changed.clear();
+				if (_notify >= 0)
+					readEvents(changed);
+				else if (now >= nextPoll) {
+					bool any = false;
+					for (File& file : _files) {
+						if (scan(file)) {
+							schedule(file, now);
+							any = true;
+						}
+					}
+					interval = any ? minInterval : std::min(interval * 2, maxInterval);
+					nextPoll = now + std::chrono::milliseconds(interval);
+				}
+				for (File* file : changed) {
+					if (scan(*file))
+						schedule(*file, now);
+				}
+
+				for (File& file : _files) {
+					if (file.pending && file.deadline <= now)
+						post(file);
+				}
+			}
+		}
+	} // namespace Registry
+} // namespace NightLightLibrary
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Watcher.h"
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		// polling interval of FileWatcher, doubles from minInterval to maxInterval while nothing changes
+		// and drops back to minInterval on a change
+		struct Polling
+		{
+			ULONGLONG	minInterval{ 50 };		// ms
+			ULONGLONG	maxInterval{ 2000 };	// ms
+		}; // struct Polling
+
+		// watches the files of a FileStore, one thread per started watcher, callbacks run on the DispatchQueue thread
+		// inotify on the directory where available, polling otherwise or when inotify cannot be set up
+		// a change is reported when the file's mtime, size or identity moved and its content hash differs
+		class FileWatcher : public Watcher
+		{
+		public:
+			typedef std::function<std::string(LPCSTR subKey)> PathOf;
+
+			// pathOf maps a subkey to the file holding its value, inside directory
+			FileWatcher(const std::string& directory, const PathOf& pathOf, const Polling& polling = {});
+			~FileWatcher();
+			FileWatcher(const FileWatcher&) = delete;
+			FileWatcher& operator=(const FileWatcher&) = delete;
+			const bool isWatching() const noexcept override;
+			void start(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback) override;
+			// once this returns the callback is not running, unless called from it, and will not be called again
+			void stop() noexcept override;
+			const bool isPaused() const noexcept override;
+			void pause() noexcept override;
+			void resume() noexcept override;
+			void setCoalescing(const Coalescing& coalescing) noexcept override;
+			// immediate callbacks run on the watcher thread and are left out of Metrics::watch()
+			void setImmediate(const bool immediate) noexcept override;
+
+			// false while polling
+			const bool isNotified() const noexcept;
+			// times the thread woke up, events or polls, the idle cost of the watcher
+			const uint64_t getWakeupCount() const noexcept;
+			// callbacks delivered
+			const uint64_t getCallbackCount() const noexcept;
+		private:
+			typedef std::chrono::steady_clock Clock;
+
+			// what a change is detected against
+			struct Stamp
+			{
+				bool		exists{ false };
+				uint64_t	mtime{ 0 };
+				uint64_t	size{ 0 };
+				uint64_t	id{ 0 };	// inode, files are replaced on write
+				uint64_t	hash{ 0 };
+			}; // struct Stamp
+
+			struct File
+			{
+				std::string			subKey;
+				std::string			path;
+				std::string			name;	// path below the directory, as reported by inotify
+				Stamp				stamp;
+				std::shared_ptr<std::atomic<bool>>	queued;	// a callback waits in the DispatchQueue
+				bool				pending{ false };
+				Clock::time_point	notified;
+				Clock::time_point	burstStart;
+				Clock::time_point	deadline;
+			}; // struct File
+
+			// reached by queued callbacks, which can outlive the watcher
+			struct Target
+			{
+				std::recursive_mutex	mutex;			// held while a callback runs
+				uint64_t				generation{ 0 };	// guarded by mutex, bumped by stop()
+				std::atomic<uint64_t>	callbacks{ 0 };
+			}; // struct Target
+
+			const std::string		_directory;
+			const PathOf			_pathOf;
+			const Polling			_polling;
+			Coalescing				_coalescing;
+			bool					_immediate{ false };
+			std::atomic<bool>		_paused{ false };
+			std::vector<File>		_files;		// watcher thread only while it runs
+			std::function<void(LPCSTR)> _callback;
+			const std::shared_ptr<Target> _target;
+			std::mutex				_mutex;
+			std::condition_variable	_wake;
+			bool					_stopping{ false };	// guarded by _mutex
+			std::thread				_thread;
+			std::atomic<int>		_notify{ -1 };		// inotify descriptor, -1 while polling
+			int						_wakePipe[2]{ -1, -1 };	// wakes the inotify wait on stop()
+			std::atomic<uint64_t>	_wakeups{ 0 };
+
+			static const bool readStamp(const std::string& path, Stamp& stamp);
+			const bool openNotify();
+			void closeNotify() noexcept;
+			// false once stopping
+			const bool wait(const Clock::time_point until);
+			// reads pending inotify events, returns the files they name
+			void readEvents(std::vector<File*>& files);
+			// true when the file changed since the last scan
+			const bool scan(File& file);
+			void schedule(File& file, const Clock::time_point now);
+			void post(File& file);
+			void watchLoop();
+		}; // class FileWatcher
+	} // namespace Registry
+} // namespace NightLightLibrary
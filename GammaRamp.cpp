@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "GammaRamp.h"
+#include "Transition.h"
+#include "nightlight_schema_constants.h"
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NL_GAMMA_SSE2
+#endif
+
+namespace NightLightLibrary
+{
+	// ramps kept by get(), at least one per entry of a transition table so replaying one stays cached
+	constexpr size_t GammaRampCacheSize = Transition::Resolution;
+
+	static const int16_t clamp(const int16_t colorTemperature) noexcept
+	{
+		namespace ct = Constants::_Settings::colorTemperature;
+		return std::min(std::max(colorTemperature, ct::Min), ct::Max);
+	}
+
+	struct WhitePoint
+	{
+		double red;
+		double green;
+		double blue;
+	}; // struct WhitePoint
+
+	// blackbody color in [0, 1], Tanner Helland's fit of the CIE 1964 10 degree color matching functions
+	static WhitePoint blackbody(const double kelvin) noexcept
+	{
+		const double t = kelvin / 100.;
+		double r, g, b;
+		if (t <= 66.) {
+			r = 255.;
+			g = 99.4708025861 * std::log(t) - 161.1195681661;
+			b = (t <= 19.) ? 0. : 138.5177312231 * std::log(t - 10.) - 305.0447927307;
+		}
+		else {
+			r = 329.698727446 * std::pow(t - 60., -0.1332047592);
+			g = 288.1221695283 * std::pow(t - 60., -0.0755148492);
+			b = 255.;
+		}
+		return {
+			std::min(std::max(r, 0.), 255.) / 255.,
+			std::min(std::max(g, 0.), 255.) / 255.,
+			std::min(std::max(b, 0.), 255.) / 255.
+		};
+	}
+
+	// ramp[i] = lround(i * scale) for i in [0, 256), scale in [0, 257]
+	static void fillChannel(uint16_t* ramp, const float scale) noexcept
+	{
+#ifdef NL_GAMMA_SSE2
+		// 8 entries per iteration, packs through signed 16 bits with a 0x8000 bias (no packus_epi32 in SSE2)
+		// truncating x + 0.5 rounds halves up like lround, cvtps would round them to even
+		// exact here since x + 0.5 stays below 2^16 and keeps the 1/256 granularity of x
+		const __m128 vscale = _mm_set1_ps(scale);
+		const __m128 half = _mm_set1_ps(.5f);
+		const __m128i bias32 = _mm_set1_epi32(0x8000);
+		const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+		const __m128 step = _mm_set1_ps(8.f);
+		__m128 low = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+		__m128 high = _mm_setr_ps(4.f, 5.f, 6.f, 7.f);
+		for (size_t i = 0; i < GammaRamp::Size; i += 8) {
+			const __m128i l = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(low, vscale), half)), bias32);
+			const __m128i h = _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(high, vscale), half)), bias32);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(ramp + i), _mm_xor_si128(_mm_packs_epi32(l, h), bias16));
+			low = _mm_add_ps(low, step);
+			high = _mm_add_ps(high, step);
+		}
+#else // NL_GAMMA_SSE2
+		for (size_t i = 0; i < GammaRamp::Size; i++)
+			ramp[i] = static_cast<uint16_t>(std::lround(i * scale));
+#endif // NL_GAMMA_SSE2
+	}
+
+	GammaRamp GammaRamp::fromColorTemperature(const int16_t colorTemperature) noexcept
+	{
+		namespace ct = Constants::_Settings::colorTemperature;
+		const int16_t kelvin = clamp(colorTemperature);
+
+		// normalized so the day temperature leaves colors untouched
+		const WhitePoint white = blackbody(ct::Default);
+		const WhitePoint color = blackbody(kelvin);
+		// i * 257 maps [0, 255] onto [0, 65535]
+		constexpr float full = 65535.f / (Size - 1);
+
+		GammaRamp ramp;
+		fillChannel(ramp.red, static_cast<float>(full * std::min(color.red / white.red, 1.)));
+		fillChannel(ramp.green, static_cast<float>(full * std::min(color.green / white.green, 1.)));
+		fillChannel(ramp.blue, static_cast<float>(full * std::min(color.blue / white.blue, 1.)));
+		return ramp;
+	}
+
+	std::shared_ptr<const GammaRamp> GammaRamp::get(const int16_t colorTemperature)
+	{
+		// out of range temperatures share the ramp of the bound they clamp to
+		const int16_t kelvin = clamp(colorTemperature);
+		typedef std::list<std::pair<int16_t, std::shared_ptr<const GammaRamp>>> Ramps;
+		static std::mutex mutex;
+		static Ramps ramps; // most recent first
+		static std::unordered_map<int16_t, Ramps::iterator> index;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto found = index.find(kelvin);
+		if (found != index.end()) {
+			ramps.splice(ramps.begin(), ramps, found->second);
+			return found->second->second;
+		}
+		ramps.emplace_front(kelvin, std::make_shared<const GammaRamp>(fromColorTemperature(kelvin)));
+		index[kelvin] = ramps.begin();
+		if (ramps.size() > GammaRampCacheSize) {
+			index.erase(ramps.back().first);
+			ramps.pop_back();
+		}
+		return ramps.front().second;
+	}
+} // namespace NightLightLibrary
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+namespace NightLightLibrary
+{
+	// 3x256 gamma ramp in the SetDeviceGammaRamp layout
+	struct GammaRamp
+	{
+		static constexpr size_t Size = 256;
+
+		uint16_t red[Size];
+		uint16_t green[Size];
+		uint16_t blue[Size];
+
+		// temperature is clamped to the schema colorTemperature bounds
+		static GammaRamp fromColorTemperature(const int16_t colorTemperature) noexcept;
+		// cached ramp for the clamped temperature, built on first use
+		static std::shared_ptr<const GammaRamp> get(const int16_t colorTemperature);
+	}; // struct GammaRamp
+} // namespace NightLightLibrary
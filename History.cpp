@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "History.h"
+#include <cstring>
+#include <iostream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace NightLightLibrary
+{
+	constexpr uint32_t HistoryMagic = 0x484c4e; // "NLH"
+	constexpr uint16_t HistoryVersion = 1;
+
+	// first bytes of the file, records follow
+	struct History::Header
+	{
+		uint32_t				magic;
+		uint16_t				version;
+		uint16_t				recordSize;
+		uint32_t				capacity;
+		uint32_t				reserved;
+		std::atomic<uint64_t>	head;
+		uint8_t					padding[40]; // keeps records off the cache line of head
+	}; // struct History::Header
+
+	static_assert(sizeof(HistoryRecord) == 16, "HistoryRecord is stored as is");
+	static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+		"atomics are stored as is");
+
+	std::shared_ptr<History> History::open(const char* path, const uint32_t capacity, const bool readOnly)
+	{
+		if (!readOnly && capacity == 0)
+			return nullptr;
+		std::shared_ptr<History> history(new History());
+#ifdef _WIN32
+		history->_file = ::CreateFileA(path, readOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+			NULL, readOnly ? OPEN_EXISTING : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (history->_file == INVALID_HANDLE_VALUE)
+			return nullptr;
+		LARGE_INTEGER length;
+		if (!::GetFileSizeEx(history->_file, &length))
+			return nullptr;
+		const ULONGLONG fileSize = static_cast<ULONGLONG>(length.QuadPart);
+#else // _WIN32
+		history->_file = ::open(path, readOnly ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+		if (history->_file == -1)
+			return nullptr;
+		struct stat status;
+		if (::fstat(history->_file, &status) != 0)
+			return nullptr;
+		const ULONGLONG fileSize = static_cast<ULONGLONG>(status.st_size);
+#endif // _WIN32
+
+		ULONGLONG size = sizeof(Header) + static_cast<ULONGLONG>(capacity) * sizeof(HistoryRecord);
+		if (readOnly)
+			size = fileSize;
+		if (size < sizeof(Header))
+			return nullptr;
+
+#ifdef _WIN32
+		// mapping a larger size grows the file
+		history->_mapping = ::CreateFileMappingA(history->_file, NULL, readOnly ? PAGE_READONLY : PAGE_READWRITE,
+			static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), NULL);
+		if (history->_mapping == NULL)
+			return nullptr;
+		void* view = ::MapViewOfFile(history->_mapping, readOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, static_cast<size_t>(size));
+		if (view == NULL)
+			return nullptr;
+#else // _WIN32
+		// mapping past the end does not grow the file here
+		if (fileSize < size && ::ftruncate(history->_file, static_cast<off_t>(size)) != 0)
+			return nullptr;
+		void* view = ::mmap(nullptr, static_cast<size_t>(size), readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, history->_file, 0);
+		if (view == MAP_FAILED)
+			return nullptr;
+		history->_size = static_cast<size_t>(size);
+#endif // _WIN32
+		history->_header = static_cast<Header*>(view);
+		history->_records = reinterpret_cast<HistoryRecord*>(static_cast<uint8_t*>(view) + sizeof(Header));
+
+		Header& header = *history->_header;
+		const bool valid = (header.magic == HistoryMagic && header.version == HistoryVersion && header.recordSize == sizeof(HistoryRecord));
+		if (readOnly) {
+			if (!valid || header.capacity == 0 || size < sizeof(Header) + static_cast<ULONGLONG>(header.capacity) * sizeof(HistoryRecord))
+				return nullptr;
+			return history;
+		}
+		// a file left larger by a bigger capacity keeps its tail unused, header.capacity tells the ring's size
+		if (!valid || header.capacity != capacity || fileSize < size) {
+#ifdef _DEBUG
+			std::cout << "[History] starting over: " << path << std::endl;
+#endif // _DEBUG
+			std::memset(view, 0, static_cast<size_t>(size));
+			header.magic = HistoryMagic;
+			header.version = HistoryVersion;
+			header.recordSize = sizeof(HistoryRecord);
+			header.capacity = capacity;
+		}
+		return history;
+	}
+
+	History::~History()
+	{
+#ifdef _WIN32
+		if (_header != nullptr)
+			::UnmapViewOfFile(_header);
+		if (_mapping != NULL)
+			::CloseHandle(_mapping);
+		if (_file != INVALID_HANDLE_VALUE)
+			::CloseHandle(_file);
+#else // _WIN32
+		if (_header != nullptr)
+			::munmap(_header, _size);
+		if (_file != -1)
+			::close(_file);
+#endif // _WIN32
+	}
+
+	void History::append(const int16_t colorTemperature, const uint8_t flags, const uint64_t timestamp) noexcept
+	{
+		const uint64_t index = _header->head.fetch_add(1, std::memory_order_relaxed);
+		HistoryRecord& record = _records[index % _header->capacity];
+		record.sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		record.colorTemperature = colorTemperature;
+		record.flags = flags;
+		record.reserved = 0;
+		record.timestamp = timestamp;
+		record.sequence.store(static_cast<uint32_t>(index + 1), std::memory_order_release);
+	}
+
+	const uint32_t History::getCapacity() const noexcept
+	{
+		return _header->capacity;
+	}
+
+	const uint64_t History::getHead() const noexcept
+	{
+		return _header->head.load(std::memory_order_acquire);
+	}
+
+	const uint64_t History::getTail() const noexcept
+	{
+		const uint64_t head = getHead();
+		return head > _header->capacity ? head - _header->capacity : 0;
+	}
+
+	const HistoryRecord* History::at(const uint64_t index) const noexcept
+	{
+		if (index >= getHead() || index < getTail())
+			return nullptr;
+		const HistoryRecord* record = &_records[index % _header->capacity];
+		if (record->sequence.load(std::memory_order_acquire) != static_cast<uint32_t>(index + 1))
+			return nullptr;
+		return record;
+	}
+
+	const bool History::isCurrent(const uint64_t index, const HistoryRecord* record) const noexcept
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return record->sequence.load(std::memory_order_relaxed) == static_cast<uint32_t>(index + 1);
+	}
+} // namespace NightLightLibrary
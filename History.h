@@ -0,0 +1,68 @@
+#pragma once
+#include "Platform.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace NightLightLibrary
+{
+	// HistoryRecord::flags
+	namespace HistoryFlag
+	{
+		constexpr uint8_t Enabled			= 1 << 0;
+		constexpr uint8_t Previewing		= 1 << 1;
+		constexpr uint8_t OnSunSchedule		= 1 << 2;
+		constexpr uint8_t Running			= 1 << 3; // status
+		constexpr uint8_t ManuallyTriggered	= 1 << 4; // trigger
+	} // namespace HistoryFlag
+
+	// one delivered change, laid out as stored in the file
+	struct HistoryRecord
+	{
+		std::atomic<uint32_t>	sequence;			// low bits of index + 1 once written, 0 while being written
+		int16_t					colorTemperature;	// night color temperature
+		uint8_t					flags;				// HistoryFlag
+		uint8_t					reserved;
+		uint64_t				timestamp;			// UTC FILETIME
+	}; // struct HistoryRecord
+
+	// fixed size ring of HistoryRecord in a memory-mapped file
+	// appends are lock-free and allocation free, readers use the mapped records in place
+	class History
+	{
+	public:
+		static constexpr uint32_t DefaultCapacity = 1 << 16; // 1 MiB of records
+
+		// maps the file, creating it or starting over when it does not hold a history of that capacity
+		// readOnly maps an existing history as is and ignores capacity, nullptr on failure
+		static std::shared_ptr<History> open(const char* path, const uint32_t capacity = DefaultCapacity, const bool readOnly = false);
+		~History();
+		History(const History&) = delete;
+		History& operator=(const History&) = delete;
+
+		void append(const int16_t colorTemperature, const uint8_t flags, const uint64_t timestamp) noexcept;
+
+		const uint32_t getCapacity() const noexcept;
+		// records ever appended, the ring holds indexes [getTail(), getHead())
+		const uint64_t getHead() const noexcept;
+		const uint64_t getTail() const noexcept;
+		// record stored for index, nullptr once overwritten or while being written
+		const HistoryRecord* at(const uint64_t index) const noexcept;
+		// call after reading a record from at(), false if it was overwritten meanwhile
+		const bool isCurrent(const uint64_t index, const HistoryRecord* record) const noexcept;
+	private:
+		struct Header;
+
+		History() = default;
+
+#ifdef _WIN32
+		HANDLE			_file{ INVALID_HANDLE_VALUE };
+		HANDLE			_mapping{ NULL };
+#else // _WIN32
+		int				_file{ -1 };
+		size_t			_size{ 0 };		// mapped bytes
+#endif // _WIN32
+		Header*			_header{ nullptr };
+		HistoryRecord*	_records{ nullptr };
+	}; // class History
+} // namespace NightLightLibrary
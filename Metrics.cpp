@@ -0,0 +1,118 @@
+#include "stdafx.h"
+#include "Metrics.h"
+#include <deque>
+#include <mutex>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+namespace NightLightLibrary
+{
+	namespace Metrics
+	{
+		static size_t bucket(const uint64_t nanoseconds) noexcept
+		{
+			if (nanoseconds == 0)
+				return 0;
+#if defined(_MSC_VER) && defined(_M_X64)
+			unsigned long highest;
+			_BitScanReverse64(&highest, nanoseconds);
+			const size_t index = highest + 1;
+#elif defined(__GNUC__)
+			const size_t index = 64 - __builtin_clzll(nanoseconds);
+#else
+			size_t index = 0;
+			for (uint64_t v = nanoseconds; v != 0; v >>= 1)
+				index++;
+#endif
+			return index < Histogram::Buckets ? index : Histogram::Buckets - 1;
+		}
+
+		void Histogram::record(const uint64_t nanoseconds) noexcept
+		{
+			_count.fetch_add(1, std::memory_order_relaxed);
+			_total.fetch_add(nanoseconds, std::memory_order_relaxed);
+			_buckets[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		Histogram::Snapshot Histogram::snapshot() const noexcept
+		{
+			// each value is exact, the set can be a few records apart while recording continues
+			Snapshot snapshot;
+			snapshot.count = _count.load(std::memory_order_relaxed);
+			snapshot.total = _total.load(std::memory_order_relaxed);
+			for (size_t i = 0; i < Buckets; i++)
+				snapshot.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+			return snapshot;
+		}
+
+		struct NamedRecordMetrics
+		{
+			std::string		name;
+			RecordMetrics	metrics;
+		}; // struct NamedRecordMetrics
+
+		static std::mutex& recordsMutex()
+		{
+			static std::mutex mutex;
+			return mutex;
+		}
+
+		// a deque keeps references stable as record types are added
+		static std::deque<NamedRecordMetrics>& records()
+		{
+			static std::deque<NamedRecordMetrics> records;
+			return records;
+		}
+
+		RecordMetrics& record(const char* name)
+		{
+			std::lock_guard<std::mutex> lock(recordsMutex());
+			for (NamedRecordMetrics& record : records()) {
+				if (record.name == name)
+					return record.metrics;
+			}
+			records().emplace_back();
+			records().back().name = name;
+			return records().back().metrics;
+		}
+
+		WatchMetrics& watch() noexcept
+		{
+			static WatchMetrics metrics;
+			return metrics;
+		}
+
+		Snapshot snapshot()
+		{
+			Snapshot snapshot;
+			{
+				std::lock_guard<std::mutex> lock(recordsMutex());
+				for (const NamedRecordMetrics& record : records()) {
+					const RecordMetrics& m = record.metrics;
+					snapshot.records.push_back({
+						record.name,
+						m.read.snapshot(), m.write.snapshot(), m.decode.snapshot(), m.encode.snapshot(),
+						m.loads, m.unchangedLoads, m.cachedLoads, m.saves,
+						m.readFailures, m.writeFailures, m.decodeFailures, m.encodeFailures,
+						m.bondDecodes, m.bondEncodes
+						});
+				}
+			}
+			const WatchMetrics& w = watch();
+			snapshot.notifyToCallback = w.notifyToCallback.snapshot();
+			snapshot.callback = w.callback.snapshot();
+			snapshot.dispatchLag = w.dispatchLag.snapshot();
+			snapshot.wakeups = w.wakeups;
+			snapshot.callbacks = w.callbacks;
+			snapshot.watchFailures = w.watchFailures;
+			snapshot.fileWakeups = w.fileWakeups;
+			snapshot.fileCallbacks = w.fileCallbacks;
+			snapshot.queueDepth = w.queueDepth;
+			snapshot.maxQueueDepth = w.maxQueueDepth;
+			snapshot.droppedCallbacks = w.droppedCallbacks;
+			snapshot.coalescedCallbacks = w.coalescedCallbacks;
+			return snapshot;
+		}
+	} // namespace Metrics
+} // namespace NightLightLibrary
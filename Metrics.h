@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NightLightLibrary
+{
+	namespace Metrics
+	{
+		// latencies in nanoseconds, so a codec call of a few hundred lands past bucket 0
+		// bucket 0 counts 0, bucket i counts [2^(i-1), 2^i), the last one everything above (about 4.6 min)
+		class Histogram
+		{
+		public:
+			static constexpr size_t Buckets = 40;
+
+			struct Snapshot
+			{
+				uint64_t	count;
+				uint64_t	total; // nanoseconds
+				uint64_t	buckets[Buckets];
+			}; // struct Snapshot
+
+			void record(const uint64_t nanoseconds) noexcept;
+			Snapshot snapshot() const noexcept;
+		private:
+			std::atomic<uint64_t>	_count{ 0 };
+			std::atomic<uint64_t>	_total{ 0 };
+			std::atomic<uint64_t>	_buckets[Buckets]{};
+		}; // class Histogram
+
+		// records the time since construction into a histogram when destroyed
+		class ScopedTimer
+		{
+		public:
+			explicit ScopedTimer(Histogram& histogram) noexcept : _histogram(histogram), _start(std::chrono::steady_clock::now()) {}
+			~ScopedTimer()
+			{
+				_histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count()));
+			}
+			ScopedTimer(const ScopedTimer&) = delete;
+			ScopedTimer& operator=(const ScopedTimer&) = delete;
+		private:
+			Histogram&								_histogram;
+			const std::chrono::steady_clock::time_point	_start;
+		}; // class ScopedTimer
+
+		// per record type, updated by Registry::load() and Registry::save()
+		struct RecordMetrics
+		{
+			Histogram				read;	// Store::read
+			Histogram				write;	// Store::write
+			Histogram				decode;
+			Histogram				encode;
+			std::atomic<uint64_t>	loads{ 0 };
+			std::atomic<uint64_t>	unchangedLoads{ 0 };	// data matched the last load or save, nothing decoded
+			std::atomic<uint64_t>	cachedLoads{ 0 };		// served by the shared RecordCache entry, nothing read
+			std::atomic<uint64_t>	saves{ 0 };
+			std::atomic<uint64_t>	readFailures{ 0 };
+			std::atomic<uint64_t>	writeFailures{ 0 };
+			std::atomic<uint64_t>	decodeFailures{ 0 };
+			std::atomic<uint64_t>	encodeFailures{ 0 };
+			std::atomic<uint64_t>	bondDecodes{ 0 };	// data the schema codec left to bond
+			std::atomic<uint64_t>	bondEncodes{ 0 };
+		}; // struct RecordMetrics
+
+		// updated by the watcher threads and the DispatchQueue, kept here so reading them starts neither
+		struct WatchMetrics
+		{
+			Histogram				notifyToCallback;	// first notification of a burst to its callback
+			Histogram				callback;			// time spent in callbacks
+			Histogram				dispatchLag;		// callback posted to DispatchQueue until it starts
+			std::atomic<uint64_t>	wakeups{ 0 };		// WatcherService raw key notifications
+			std::atomic<uint64_t>	callbacks{ 0 };		// WatcherService delivered callbacks
+			std::atomic<uint64_t>	watchFailures{ 0 };	// WatcherService keys dropped after an arm or wait error
+			std::atomic<uint64_t>	fileWakeups{ 0 };	// FileWatcher events and polls
+			std::atomic<uint64_t>	fileCallbacks{ 0 };
+			std::atomic<uint64_t>	queueDepth{ 0 };
+			std::atomic<uint64_t>	maxQueueDepth{ 0 };
+			std::atomic<uint64_t>	droppedCallbacks{ 0 };
+			std::atomic<uint64_t>	coalescedCallbacks{ 0 };
+		}; // struct WatchMetrics
+
+		struct RecordSnapshot
+		{
+			std::string					name; // registry subkey
+			Histogram::Snapshot			read;
+			Histogram::Snapshot			write;
+			Histogram::Snapshot			decode;
+			Histogram::Snapshot			encode;
+			uint64_t					loads;
+			uint64_t					unchangedLoads;
+			uint64_t					cachedLoads;
+			uint64_t					saves;
+			uint64_t					readFailures;
+			uint64_t					writeFailures;
+			uint64_t					decodeFailures;
+			uint64_t					encodeFailures;
+			uint64_t					bondDecodes;	// decoded by bond, the codec could not
+			uint64_t					bondEncodes;
+		}; // struct RecordSnapshot
+
+		struct Snapshot
+		{
+			std::vector<RecordSnapshot>	records;
+			Histogram::Snapshot			notifyToCallback;
+			Histogram::Snapshot			callback;
+			Histogram::Snapshot			dispatchLag;
+			uint64_t					wakeups;	// raw key notifications
+			uint64_t					callbacks;	// delivered callbacks
+			uint64_t					watchFailures;	// keys no longer watched after an error
+			uint64_t					fileWakeups;	// FileWatcher events and polls, what an idle watcher costs
+			uint64_t					fileCallbacks;
+			uint64_t					queueDepth;		// callbacks waiting for the callback thread
+			uint64_t					maxQueueDepth;
+			uint64_t					droppedCallbacks;	// oldest callbacks dropped from a full queue
+			uint64_t					coalescedCallbacks;	// notifications merged into a queued callback
+		}; // struct Snapshot
+
+		// metrics of the record type stored under name, created on first use and never freed
+		RecordMetrics& record(const char* name);
+		WatchMetrics& watch() noexcept;
+		// process-wide, counters only grow
+		Snapshot snapshot();
+	} // namespace Metrics
+} // namespace NightLightLibrary
@@ -2,6 +2,17 @@
 #include "NightLightWrapper.h"
 #include "State.h"
 #include "Settings.h"
+#include "Transition.h"
+#include "CriticalSection.h"
+#include "GammaRamp.h"
+#include "SeqLock.h"
+#include "Executor.h"
+#include "Scheduler.h"
+#include "SunSchedule.h"
+#include "History.h"
+#include <future>
+#include <mutex>
+#include <vector>
 
 namespace NightLightLibrary
 {
@@ -16,6 +27,27 @@ namespace NightLightLibrary
 	// during which the status change will be considered as a manual change
 	constexpr ULONGLONG SettingsEnducedStatusChangePeriod = 100; // ms
 
+	// everything the getters read, published as a whole after each change to the records
+	struct Snapshot
+	{
+		ULONGLONG	lastStatusChangeTime;
+		int16_t		dayColorTemperature;
+		int16_t		nightColorTemperature;
+		int8_t		startHours;
+		int8_t		startMinutes;
+		int8_t		endHours;
+		int8_t		endMinutes;
+		bool		enabled;
+		bool		onSunSchedule;
+		bool		previewing;
+		bool		running;
+		bool		usable;
+		bool		manuallyTriggered;
+		bool		statusChanged;
+		bool		settingsChanged;
+		bool		previewingChanged;
+	}; // struct Snapshot
+
 #pragma region NightLight
 	class NightLightWrapper::NightLight
 	{
@@ -27,6 +59,12 @@ namespace NightLightLibrary
 		}
 		~NightLight() noexcept
 		{
+			{
+				// queued async operations reference this
+				std::unique_lock<std::mutex> lock(_asyncMutex);
+				_asyncDone.wait(lock, [this]() { return _asyncCount == 0; });
+			}
+			stopScheduler();
 			stopWatching();
 		}
 
@@ -34,6 +72,9 @@ namespace NightLightLibrary
 		{
 			Settings settings;
 			State state;
+			// served by the shared entries of live wrappers, without creating entries of its own
+			settings._shareCache = false;
+			state._shareCache = false;
 			const bool supported = Settings::load(settings) && State::load(state);
 			if (!supported)
 				return false;
@@ -49,45 +90,75 @@ namespace NightLightLibrary
 
 		NightLight& resume()
 		{
+			Mutation mutation(*this);
 			_state.resume();
 			return *this;
 		}
 
 		NightLight& pause() noexcept
 		{
+			Mutation mutation(*this);
 			_state.pause();
 			return *this;
 		}
 
-		const bool isRunning() const
+		const bool isRunning() const noexcept
 		{
-			return _state.isRunning();
+			return _snapshot.load().running;
 		}
 
 		const bool isUsable() const noexcept
 		{
-			return _state.isUsable();
+			return _snapshot.load().usable;
 		}
 
 		NightLight& useSunSchedule() noexcept
 		{
+			Mutation mutation(*this);
 			_settings.setOnSunSchedule(true);
 			return *this;
 		}
 
 		NightLight& useManualSchedule() noexcept
 		{
+			Mutation mutation(*this);
 			_settings.setOnSunSchedule(false);
 			return *this;
 		}
 
 		const bool isOnSunSchedule() const noexcept
 		{
-			return _settings.isOnSunSchedule();
+			return _snapshot.load().onSunSchedule;
+		}
+
+		NightLight& updateSunSchedule(const double latitude, const double longitude)
+		{
+			SYSTEMTIME today;
+			::GetLocalTime(&today);
+			const SunTimes sun = SunSchedule::get(latitude, longitude, today.wYear)->at(SunSchedule::dayOfYear(today));
+			Time start, end;
+			switch (sun.cycle)
+			{
+			case SunCycle::PolarNight: // night all day, the end is inclusive
+				start.setHours(0).setMinutes(0);
+				end.setHours(23).setMinutes(59);
+				break;
+			case SunCycle::PolarDay: // no night, an empty schedule
+				start.setHours(static_cast<int8_t>(sun.sunrise / 60)).setMinutes(static_cast<int8_t>(sun.sunrise % 60));
+				end = start;
+				break;
+			default:
+				start.setHours(static_cast<int8_t>(sun.sunset / 60)).setMinutes(static_cast<int8_t>(sun.sunset % 60));
+				end.setHours(static_cast<int8_t>(sun.sunrise / 60)).setMinutes(static_cast<int8_t>(sun.sunrise % 60));
+			}
+			Mutation mutation(*this);
+			_settings.setSunSchedule(start, end);
+			return *this;
 		}
 
 		NightLight& enable() noexcept
 		{
+			Mutation mutation(*this);
 			_settings.setEnabled(true);
 			// replicating behavior: not scheduled => scheduled + within range = running
 			//if (isWithinTimeRange())
@@ -97,23 +168,26 @@ namespace NightLightLibrary
 
 		NightLight& disable() noexcept
 		{
+			Mutation mutation(*this);
 			_settings.setEnabled(false);
 			return *this;
 		}
 
 		const bool isEnabled() const noexcept
 		{
-			return _settings.isEnabled();
+			return _snapshot.load().enabled;
 		}
 
 		NightLight& disableSystemUI() noexcept
 		{
+			Mutation mutation(*this);
 			_state.setUsable(false);
 			return *this;
 		}
 
 		NightLight& setStartTime(const Time& t)
 		{
+			Mutation mutation(*this);
 			_settings.setStartTime(t);
 			useManualSchedule();
 			return *this;
@@ -121,6 +195,7 @@ namespace NightLightLibrary
 
 		NightLight& setEndTime(const Time& t)
 		{
+			Mutation mutation(*this);
 			_settings.setEndTime(t);
 			useManualSchedule();
 			return *this;
@@ -128,75 +203,108 @@ namespace NightLightLibrary
 
 		Time getStartTime() const noexcept
 		{
-			return _settings.getStartTime();
+			return _getStartTime(_snapshot.load());
 		}
 
 		Time getEndTime() const noexcept
 		{
-			return _settings.getEndTime();
+			return _getEndTime(_snapshot.load());
 		}
 
 		const bool isWithinTimeRange() const
 		{
-			return Time::now().isWithinRange(getStartTime(), getEndTime());
+			const Snapshot snapshot = _snapshot.load();
+			const Time start = _getStartTime(snapshot);
+			const Time end = _getEndTime(snapshot);
+			// empty, like the Scheduler sees it
+			if (start.toMinutes() == end.toMinutes())
+				return false;
+			return Time::now().isWithinRange(start, end);
 		}
 
-		const int16_t getColorTemperature() const
+		const int16_t getColorTemperature() const noexcept
 		{
-			return isRunning() || isPreviewing() ? getNightColorTemperature() : getDayColorTemperature();
+			return _getColorTemperature(_snapshot.load());
 		}
 
 		const int16_t getDayColorTemperature() const noexcept
 		{
-			return _settings.getDayColorTemperature();
+			return _snapshot.load().dayColorTemperature;
 		}
 
 		const int16_t getNightColorTemperature() const noexcept
 		{
-			return _settings.getNightColorTemperature();
+			return _snapshot.load().nightColorTemperature;
 		}
 
 		NightLight& setNightColorTemperature(const int16_t ct)
 		{
+			Mutation mutation(*this);
 			_settings.setNightColorTemperature(ct);
 			return *this;
 		}
 
 		const ULONGLONG getSmootheningDuration() const noexcept
 		{
-			if (_statusChanged && (_settingsChanged || _state.wasManuallyTriggered()))
-				return static_cast<ULONGLONG>(SmootheningDuration::Short);
-			if (_statusChanged && _state.wasManuallyTriggered() == false)
-				return static_cast<ULONGLONG>(SmootheningDuration::Long);
-			return static_cast<ULONGLONG>(SmootheningDuration::None);
+			return _getSmootheningDuration(_snapshot.load());
 		}
 
 		const int16_t getSmoothenedColorTemperature() const
 		{
-			const ULONGLONG duration = getSmootheningDuration();
+			const Snapshot snapshot = _snapshot.load();
+			const ULONGLONG duration = _getSmootheningDuration(snapshot);
 			if (duration == 0)
-				return getColorTemperature();
-			const ULONGLONG timeSinceStatusChange = ::GetTickCount64() - _lastStatusChangeTime; // ms
+				return _getColorTemperature(snapshot);
+			const ULONGLONG timeSinceStatusChange = ::GetTickCount64() - snapshot.lastStatusChangeTime; // ms
 			if (timeSinceStatusChange >= duration)
-				return getColorTemperature();
+				return _getColorTemperature(snapshot);
+			return _readTransition(snapshot, duration, [timeSinceStatusChange](const Transition& transition) {
+				return transition.at(timeSinceStatusChange);
+				});
+		}
 
-			const int16_t from = !isRunning() ? getNightColorTemperature() : getDayColorTemperature();
-			const int16_t to = isRunning() ? getNightColorTemperature() : getDayColorTemperature();
-			return static_cast<int16_t>(from + (to - from) * (timeSinceStatusChange / static_cast<double>(duration)));
+		void getSmoothenedColorTemperatures(int16_t* temperatures, const size_t count, const uint32_t frameInterval) const
+		{
+			const Snapshot snapshot = _snapshot.load();
+			size_t filled = 0;
+			const ULONGLONG duration = _getSmootheningDuration(snapshot);
+			if (duration != 0)
+				filled = _readTransition(snapshot, duration, [&](const Transition& transition) {
+					return transition.fill(temperatures, count, ::GetTickCount64() - snapshot.lastStatusChangeTime, frameInterval);
+					});
+			std::fill(temperatures + filled, temperatures + count, _getColorTemperature(snapshot));
+		}
+
+		NightLight& setTransitionCurve(const TransitionCurve curve) noexcept
+		{
+			_curve = curve;
+			return *this;
+		}
+
+		const TransitionCurve getTransitionCurve() const noexcept
+		{
+			return _curve;
 		}
 
 		const bool isPreviewing() const noexcept
 		{
-			return _settings.isPreviewing();
+			return _snapshot.load().previewing;
 		}
 
 		const bool wasPreviewing() const noexcept
 		{
-			return _previewingChanged;
+			return _snapshot.load().previewingChanged;
+		}
+
+		// number of snapshots published so far, changes whenever any getter may return something new
+		const uint64_t getVersion() const noexcept
+		{
+			return _snapshot.getVersion();
 		}
 
 		NightLight& save(const bool dontTrigger = true)
 		{
+			Mutation mutation(*this);
 			if (dontTrigger)
 				pauseWatching();
 			_settings.save();
@@ -206,15 +314,48 @@ namespace NightLightLibrary
 			return *this;
 		}
 
+		// runs changes, then writes each record at most once and only if its content changed
+		NightLight& apply(const std::function<void()>& changes, const bool dontTrigger = true)
+		{
+			Mutation mutation(*this);
+			const _Settings<Time> settings = _settings;
+			const _State state = _state;
+			const bool settingsDirty = _settings._dirty;
+			const bool stateDirty = _state._dirty;
+			changes();
+			// setters flag records as dirty even when they set the current value
+			// only the flags set by changes are cleared, changes made before apply() are still unsaved
+			if (!settingsDirty && _settings == settings)
+				_settings._dirty = false;
+			if (!stateDirty && _state == state)
+				_state._dirty = false;
+			if (!_settings._dirty && !_state._dirty)
+				return *this;
+			return save(dontTrigger);
+		}
+
 		NightLight& load(const bool ignoreStatusChange = false)
 		{
+			Mutation mutation(*this);
 			_loadSettings(ignoreStatusChange);
 			_loadState(ignoreStatusChange);
 			return *this;
 		}
 
+		// calls made before the queued operation starts share it
+		std::shared_future<void> loadAsync(const bool ignoreStatusChange = false)
+		{
+			return _post(_queuedLoads[ignoreStatusChange], [this, ignoreStatusChange]() { load(ignoreStatusChange); });
+		}
+
+		std::shared_future<void> saveAsync(const bool dontTrigger = true)
+		{
+			return _post(_queuedSaves[dontTrigger], [this, dontTrigger]() { save(dontTrigger); });
+		}
+
 		NightLight& backup()
 		{
+			Mutation mutation(*this);
 			// tag backups as dirty so the restore() will save() only after a successful load()
 			_backupSettings._dirty = Settings::load(_backupSettings);
 			_backupState._dirty = State::load(_backupState);
@@ -223,25 +364,36 @@ namespace NightLightLibrary
 
 		NightLight& restore()
 		{
+			Mutation mutation(*this);
 			_backupSettings.save();
 			_backupState.save();
 			return load();
 		}
 
-		NightLight& startWatching(const std::function<void(NightLight&)>& callback = [](NightLight&) noexcept {})
+		NightLight& startWatching(const std::function<void(NightLight&, const uint32_t)>& callback = [](NightLight&, const uint32_t) noexcept {})
 		{
 			_state.startWatching([&, callback]() {
-				_loadState();
-#ifdef _DEBUG
-				// delay state callback to allow settings callback to print to console without mixing both outputs
-				std::this_thread::sleep_for(std::chrono::milliseconds(100));
-#endif // _DEBUG
-				callback(*this);
-				});
+				uint32_t changes;
+				{
+					Mutation mutation(*this);
+					changes = _loadState();
+				}
+				if (changes == Field::None)
+					return;
+				_record();
+				callback(*this, changes);
+				}, _coalescing);
 			_settings.startWatching([&, callback]() {
-				_loadSettings();
-				callback(*this);
-				});
+				uint32_t changes;
+				{
+					Mutation mutation(*this);
+					changes = _loadSettings();
+				}
+				if (changes == Field::None)
+					return;
+				_record();
+				callback(*this, changes);
+				}, _coalescing);
 			return *this;
 		}
 
@@ -266,7 +418,133 @@ namespace NightLightLibrary
 			return *this;
 		}
 
+		static const bool replayCorpus(const char* path, ReplayReport& report)
+		{
+			report = {};
+			std::vector<Registry::Corpus::Entry> entries;
+			if (!Registry::Corpus::read(path, entries) && entries.empty())
+				return false;
+
+			const std::shared_ptr<Registry::MemoryStore> store = std::make_shared<Registry::MemoryStore>();
+			Settings settings;
+			State state;
+			settings.setStore(store);
+			state.setStore(store);
+			std::chrono::steady_clock::duration elapsed{ 0 };
+			for (const Registry::Corpus::Entry& entry : entries) {
+				report.blobs++;
+				if (entry.subKey == Settings::getRegistryKey())
+					_replay<Settings, _Settings<Time>>(entry, *store, settings, report, elapsed);
+				else if (entry.subKey == State::getRegistryKey())
+					_replay<State, _State>(entry, *store, state, report, elapsed);
+				else
+					report.unknown++;
+			}
+			report.seconds = std::chrono::duration<double>(elapsed).count();
+			report.blobsPerSecond = report.seconds > 0 ? (report.blobs - report.unknown) / report.seconds : 0;
+			return true;
+		}
+
+		const bool startRecording(const char* path, const uint32_t capacity)
+		{
+			const std::shared_ptr<History> history = History::open(path, capacity);
+			if (!history)
+				return false;
+			std::atomic_store(&_history, history);
+			return true;
+		}
+
+		NightLight& stopRecording() noexcept
+		{
+			std::atomic_store(&_history, std::shared_ptr<History>());
+			return *this;
+		}
+
+		const bool isRecording() const noexcept
+		{
+			return std::atomic_load(&_history) != nullptr;
+		}
+
+#ifdef _WIN32
+		NightLight& startScheduler(const std::function<void(NightLight&, const ScheduleEvent)>& callback)
+		{
+			stopScheduler();
+			Mutation mutation(*this); // publishing arms the new scheduler
+			_scheduler = std::make_unique<Scheduler>([this, callback](const ScheduleEvent event) {
+				callback(*this, event);
+				}, static_cast<ULONGLONG>(SmootheningDuration::Long));
+			return *this;
+		}
+
+		NightLight& stopScheduler() noexcept
+		{
+			std::unique_ptr<Scheduler> scheduler;
+			{
+				// destroyed outside the lock, its thread may be in a callback calling setters
+				std::lock_guard<CriticalSection> lock(_mutex);
+				scheduler.swap(_scheduler);
+			}
+			return *this;
+		}
+
+		const bool getNextScheduleEvent(ScheduleEvent& event, uint64_t& dueTime) const
+		{
+			std::lock_guard<CriticalSection> lock(_mutex);
+			ULONGLONG due;
+			if (!_scheduler || !_scheduler->getNext(event, due))
+				return false;
+			dueTime = due;
+			return true;
+		}
+#else // _WIN32
+		// the scheduler waits on a Win32 waitable timer, elsewhere it stays stopped
+		NightLight& startScheduler(const std::function<void(NightLight&, const ScheduleEvent)>& callback)
+		{
+			UNREFERENCED_PARAMETER(callback);
+			return *this;
+		}
+
+		NightLight& stopScheduler() noexcept
+		{
+			return *this;
+		}
+
+		const bool getNextScheduleEvent(ScheduleEvent& event, uint64_t& dueTime) const
+		{
+			UNREFERENCED_PARAMETER(event);
+			UNREFERENCED_PARAMETER(dueTime);
+			return false;
+		}
+#endif // _WIN32
+
+		NightLight& setWatchCoalescing(const uint32_t quietPeriod, const uint32_t maxDelay) noexcept
+		{
+			_coalescing.quietPeriod = quietPeriod;
+			_coalescing.maxDelay = maxDelay;
+			return *this;
+		}
+
 	private:
+		// serializes changes to the records, which the application and the watcher thread both make,
+		// and publishes a new snapshot once the outermost change is done
+		class Mutation
+		{
+		public:
+			Mutation(NightLight& nl) noexcept : _nl(nl), _lock(nl._mutex)
+			{
+				_nl._mutationDepth++;
+			}
+			~Mutation() noexcept
+			{
+				if (--_nl._mutationDepth == 0)
+					_nl._publish();
+			}
+		private:
+			NightLight& _nl;
+			std::lock_guard<CriticalSection> _lock;
+		}; // class Mutation
+
+		// only touched by the thread holding _mutex, getters read _snapshot instead
 		Settings	_settings;
 		State		_state;
 		Settings	_backupSettings;
@@ -280,12 +558,258 @@ namespace NightLightLibrary
 
 		std::atomic<bool>		_previewingChanged{ false };
 
-		NightLight& _loadState(const bool ignoreStatusChange = false)
+		mutable CriticalSection	_mutex;
+		unsigned int			_mutationDepth{ 0 };
+		SeqLock<Snapshot>		_snapshot;
+#ifdef _WIN32
+		std::unique_ptr<Scheduler>	_scheduler; // guarded by _mutex
+#endif // _WIN32
+		std::shared_ptr<History>	_history;
+
+		// async operations queued on the executor and not started yet, indexed by their bool argument
+		std::mutex				_asyncMutex;
+		std::condition_variable	_asyncDone;
+		std::shared_future<void> _queuedLoads[2];
+		std::shared_future<void> _queuedSaves[2];
+		unsigned int			_asyncCount{ 0 };
+
+		Registry::Coalescing	_coalescing;
+
+		std::atomic<TransitionCurve>	_curve{ TransitionCurve::Linear };
+		// last transition used, read without locks by every frame of that transition
+		// replaced ones are released once no frame is reading, see _readTransition()
+		mutable std::atomic<const Transition*>	_transition{ nullptr };
+		mutable std::atomic<unsigned int>		_transitionReaders{ 0 };
+		mutable std::mutex						_transitionMutex;	// serializes replacements
+		mutable std::vector<std::shared_ptr<const Transition>> _transitions; // guarded by _transitionMutex, current one last
+
+		void _record() const noexcept
 		{
+			const std::shared_ptr<History> history = std::atomic_load(&_history);
+			if (!history)
+				return;
+			const Snapshot snapshot = _snapshot.load();
+			const uint8_t flags = (snapshot.enabled ? HistoryFlag::Enabled : 0)
+				| (snapshot.previewing ? HistoryFlag::Previewing : 0)
+				| (snapshot.onSunSchedule ? HistoryFlag::OnSunSchedule : 0)
+				| (snapshot.running ? HistoryFlag::Running : 0)
+				| (snapshot.manuallyTriggered ? HistoryFlag::ManuallyTriggered : 0);
+			FILETIME now;
+			::GetSystemTimeAsFileTime(&now);
+			ULARGE_INTEGER timestamp;
+			timestamp.LowPart = now.dwLowDateTime;
+			timestamp.HighPart = now.dwHighDateTime;
+			history->append(snapshot.nightColorTemperature, flags, timestamp.QuadPart);
+		}
+
+		std::shared_future<void> _post(std::shared_future<void>& queued, const std::function<void()>& operation)
+		{
+			std::lock_guard<std::mutex> lock(_asyncMutex);
+			if (queued.valid())
+				return queued;
+			std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+			queued = promise->get_future().share();
+			_asyncCount++;
+			Executor::instance().post([this, &queued, promise, operation]() {
+				{
+					// requests from now on need a new operation to see the stored data
+					std::lock_guard<std::mutex> lock(_asyncMutex);
+					queued = std::shared_future<void>();
+				}
+				try {
+					operation();
+					promise->set_value();
+				}
+				catch (...) {
+					promise->set_exception(std::current_exception());
+				}
+				std::lock_guard<std::mutex> lock(_asyncMutex);
+				if (--_asyncCount == 0)
+					_asyncDone.notify_all();
+				});
+			return queued;
+		}
+
+		void _publish() noexcept
+		{
+			Snapshot snapshot;
+			snapshot.lastStatusChangeTime = _lastStatusChangeTime;
+			snapshot.dayColorTemperature = _settings.getDayColorTemperature();
+			snapshot.nightColorTemperature = _settings.getNightColorTemperature();
+			const Time start = _settings.getStartTime();
+			const Time end = _settings.getEndTime();
+			snapshot.startHours = start.hours;
+			snapshot.startMinutes = start.minutes;
+			snapshot.endHours = end.hours;
+			snapshot.endMinutes = end.minutes;
+			snapshot.enabled = _settings.isEnabled();
+			snapshot.onSunSchedule = _settings.isOnSunSchedule();
+			snapshot.previewing = _settings.isPreviewing();
+			snapshot.running = _state.isRunning();
+			snapshot.usable = _state.isUsable();
+			snapshot.manuallyTriggered = _state.wasManuallyTriggered();
+			snapshot.statusChanged = _statusChanged;
+			snapshot.settingsChanged = _settingsChanged;
+			snapshot.previewingChanged = _previewingChanged;
+			_snapshot.store(snapshot);
+			// only rearms when the schedule changed
+#ifdef _WIN32
+			if (_scheduler)
+				_scheduler->reschedule(snapshot.enabled, start.toMinutes(), end.toMinutes());
+#endif // _WIN32
+		}
+
+		static Time _getStartTime(const Snapshot& snapshot) noexcept
+		{
+			Time t;
+			t.hours = snapshot.startHours;
+			t.minutes = snapshot.startMinutes;
+			return t;
+		}
+
+		static Time _getEndTime(const Snapshot& snapshot) noexcept
+		{
+			Time t;
+			t.hours = snapshot.endHours;
+			t.minutes = snapshot.endMinutes;
+			return t;
+		}
+
+		static const int16_t _getColorTemperature(const Snapshot& snapshot) noexcept
+		{
+			return snapshot.running || snapshot.previewing ? snapshot.nightColorTemperature : snapshot.dayColorTemperature;
+		}
+
+		static const ULONGLONG _getSmootheningDuration(const Snapshot& snapshot) noexcept
+		{
+			if (snapshot.statusChanged && (snapshot.settingsChanged || snapshot.manuallyTriggered))
+				return static_cast<ULONGLONG>(SmootheningDuration::Short);
+			if (snapshot.statusChanged && snapshot.manuallyTriggered == false)
+				return static_cast<ULONGLONG>(SmootheningDuration::Long);
+			return static_cast<ULONGLONG>(SmootheningDuration::None);
+		}
+
+		// counts a frame reading _transition, replaced transitions are released only while none is
+		class TransitionReader
+		{
+		public:
+			TransitionReader(const NightLight& nl) noexcept : _nl(nl) { _nl._transitionReaders++; }
+			~TransitionReader() noexcept { _nl._transitionReaders--; }
+		private:
+			const NightLight& _nl;
+		}; // class TransitionReader
+
+		// calls read with the transition of the snapshot, a load and a compare while it does not change
+		template<typename F> auto _readTransition(const Snapshot& snapshot, const ULONGLONG duration, const F& read) const
+			-> decltype(read(std::declval<const Transition&>()))
+		{
+			const int16_t from = !snapshot.running ? snapshot.nightColorTemperature : snapshot.dayColorTemperature;
+			const int16_t to = snapshot.running ? snapshot.nightColorTemperature : snapshot.dayColorTemperature;
+			const TransitionCurve curve = _curve;
+			TransitionReader reader(*this);
+			const Transition* transition = _transition.load();
+			if (transition == nullptr || !transition->matches(from, to, duration, curve))
+				transition = _replaceTransition(from, to, duration, curve);
+			return read(*transition);
+		}
+
+		// called by a counted reader, the returned transition stays alive until that reader is done
+		const Transition* _replaceTransition(const int16_t from, const int16_t to, const ULONGLONG duration, const TransitionCurve curve) const
+		{
+			std::shared_ptr<const Transition> transition = Transition::get(from, to, duration, curve);
+			std::lock_guard<std::mutex> lock(_transitionMutex);
+			_transitions.push_back(transition);
+			_transition.store(transition.get());
+			// a reader counted after the store loads the new transition, so only the caller can be holding the older ones
+			if (_transitionReaders.load() == 1)
+				_transitions.erase(_transitions.begin(), _transitions.end() - 1);
+			return transition.get();
+		}
+
+		template<typename T, typename Data> static void _replay(const Registry::Corpus::Entry& entry, Registry::Store& store, T& record,
+			ReplayReport& report, std::chrono::steady_clock::duration& elapsed)
+		{
+			store.write(T::getRegistryKey(), T::getRegistryValueName(), entry.data.data(), entry.data.size());
+			const Data previous = record;
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			const Registry::LoadResult result = T::refresh(record);
+			elapsed += std::chrono::steady_clock::now() - start;
+			if (result == Registry::LoadResult::Failed) {
+				report.failures++;
+				return;
+			}
+			if (result == Registry::LoadResult::Unchanged) {
+				report.unchanged++;
+				return;
+			}
+			report.decoded++;
+			const uint32_t changes = diff(previous, record);
+			for (size_t bit = 0; bit < 32; bit++)
+				report.changes[bit] += (changes >> bit) & 1;
+
+			// bond's reading of the same blob shows the fields the schema codec gets wrong
+			T reference;
+			try
+			{
+				::bond::InputBuffer input(entry.data.data(), static_cast<uint32_t>(entry.data.size()));
+				Registry::Header header;
+				input.Read(&header, sizeof(header));
+				Registry::unmarshal(input, reference._reset());
+			}
+			catch (const std::exception&)
+			{
+				return; // the codec read what bond could not
+			}
+			const uint32_t mismatches = diff(reference, record);
+			for (size_t bit = 0; bit < 32; bit++)
+				report.fieldFailures[bit] += (mismatches >> bit) & 1;
+		}
+
+		static const uint32_t diff(const _State& a, const _State& b) noexcept
+		{
+			uint32_t changes = Field::None;
+			if (a.status != b.status)
+				changes |= Field::Status;
+			if (a.trigger != b.trigger)
+				changes |= Field::Trigger;
+			if (a.changedOn != b.changedOn)
+				changes |= Field::ChangedOn;
+			if (a.usable != b.usable)
+				changes |= Field::Usable;
+			return changes;
+		}
+
+		static const uint32_t diff(const _Settings<Time>& a, const _Settings<Time>& b) noexcept
+		{
+			uint32_t changes = Field::None;
+			if (a.enabled != b.enabled)
+				changes |= Field::Enabled;
+			if (a.onSunSchedule != b.onSunSchedule)
+				changes |= Field::OnSunSchedule;
+			if (a.manualScheduleStartTime != b.manualScheduleStartTime || a.manualScheduleEndTime != b.manualScheduleEndTime)
+				changes |= Field::ManualSchedule;
+			if (a.colorTemperature != b.colorTemperature)
+				changes |= Field::ColorTemperature;
+			if (a.sunScheduleStartTime != b.sunScheduleStartTime || a.sunScheduleEndTime != b.sunScheduleEndTime)
+				changes |= Field::SunSchedule;
+			if (a.previewing != b.previewing)
+				changes |= Field::Previewing;
+			return changes;
+		}
+
+		// returns the changed fields, Field::None when the stored data did not change
+		const uint32_t _loadState(const bool ignoreStatusChange = false)
+		{
+			const _State previous = _state;
+			const bool previousStatus = _state.isRunning();
+			// the flag describes this load, unchanged data included
 			_statusChanged = false;
-			const bool previousStatus = isRunning();
-			if (State::load(_state) && ignoreStatusChange == false) {
-				_statusChanged = (previousStatus != isRunning());
+			const Registry::LoadResult result = State::refresh(_state);
+			if (result == Registry::LoadResult::Unchanged)
+				return Field::None;
+
+			if (result == Registry::LoadResult::Loaded && ignoreStatusChange == false) {
+				_statusChanged = (previousStatus != _state.isRunning());
 				if (_statusChanged) {
 					_lastStatusChangeTime = ::GetTickCount64();
 
@@ -298,26 +822,28 @@ namespace NightLightLibrary
 						_settingsChanged = false;
 				}
 			}
-			return *this;
+			return diff(previous, _state);
 		}
 
-		NightLight& _loadSettings(const bool ignoreStatusChange = false)
+		// returns the changed fields, Field::None when the stored data did not change
+		const uint32_t _loadSettings(const bool ignoreStatusChange = false)
 		{
-			const bool previouPreviewing = isPreviewing();
-			Settings previous;
-			previous.swap(_settings);
-			if (Settings::load(_settings) && ignoreStatusChange == false) {
+			const _Settings<Time> previous = _settings;
+			const Registry::LoadResult result = Settings::refresh(_settings);
+			// unchanged data is still a load, the flags describe it rather than the previous one
+			const uint32_t changes = result == Registry::LoadResult::Loaded ? diff(previous, _settings) : Field::None;
+			if (result != Registry::LoadResult::Failed && ignoreStatusChange == false) {
 				ULONGLONG now = ::GetTickCount64();
 				if (now > _lastSettingsChangeTime + SettingsEnducedStatusChangePeriod)
-					_settingsChanged = (previous != _settings);
+					_settingsChanged = (changes != Field::None);
 
 				if (_settingsChanged) {
 					_lastSettingsChangeTime = now;
 					_statusChanged = false;
 				}
 			}
-			_previewingChanged = (previouPreviewing != isPreviewing() && _settingsChanged);
-			return *this;
+			_previewingChanged = ((changes & Field::Previewing) != 0 && _settingsChanged);
+			return changes;
 		}
 	}; // class NightLightWrapper::NightLight
 
@@ -357,12 +883,45 @@ NightLightWrapper& NightLightWrapper::get##_name_##Time(int8_t& hours, int8_t& m
 	NightLightWrapper::NightLightWrapper() : _nl(std::make_unique<NightLight>()) {}
 	NightLightWrapper::~NightLightWrapper() = default;
 
+	std::future<std::unique_ptr<NightLightWrapper>> NightLightWrapper::createAsync()
+	{
+		std::shared_ptr<std::promise<std::unique_ptr<NightLightWrapper>>> promise = std::make_shared<std::promise<std::unique_ptr<NightLightWrapper>>>();
+		std::future<std::unique_ptr<NightLightWrapper>> future = promise->get_future();
+		Executor::instance().post([promise]() {
+			try {
+				promise->set_value(std::make_unique<NightLightWrapper>());
+			}
+			catch (...) {
+				promise->set_exception(std::current_exception());
+			}
+			});
+		return future;
+	}
+
 	const bool NightLightWrapper::isSupported(const bool checkEnabled)
 	{
 		return NightLight::isSupported(checkEnabled);
 	}
 
+#ifdef _WIN32
+	void NightLightWrapper::useRegistryStore()
+	{
+		Registry::setDefaultStore(std::make_shared<Registry::RegistryStore>());
+	}
+#endif // _WIN32
+
+	void NightLightWrapper::useMemoryStore()
+	{
+		Registry::setDefaultStore(std::make_shared<Registry::MemoryStore>());
+	}
+
+	void NightLightWrapper::useFileStore(const char* directory)
+	{
+		Registry::setDefaultStore(std::make_shared<Registry::FileStore>(directory));
+	}
+
 	NL_NONCHAINABLE_WRAPPER(const bool, didStatusChange, const noexcept);
+	NL_NONCHAINABLE_WRAPPER(const uint64_t, getVersion, const noexcept);
 
 	NL_CHAINABLE_WRAPPER(disable,,, noexcept);
 	NL_CHAINABLE_WRAPPER(enable,,, noexcept);
@@ -381,6 +940,12 @@ NightLightWrapper& NightLightWrapper::get##_name_##Time(int8_t& hours, int8_t& m
 
 	NL_NONCHAINABLE_WRAPPER(const bool, isOnSunSchedule, const noexcept);
 
+	NightLightWrapper& NightLightWrapper::updateSunSchedule(const double latitude, const double longitude)
+	{
+		_nl->updateSunSchedule(latitude, longitude);
+		return *this;
+	}
+
 	NL_SET_TIME_WRAPPER(Start);
 	NL_SET_TIME_WRAPPER(End);
 
@@ -389,6 +954,20 @@ NightLightWrapper& NightLightWrapper::get##_name_##Time(int8_t& hours, int8_t& m
 
 	NL_NONCHAINABLE_WRAPPER(const bool, isWithinTimeRange, const);
 	NL_NONCHAINABLE_WRAPPER(const int16_t, getSmoothenedColorTemperature, const);
+	NL_NONCHAINABLE_WRAPPER(const TransitionCurve, getTransitionCurve, const noexcept);
+	NL_CHAINABLE_WRAPPER(setTransitionCurve, const TransitionCurve, curve, noexcept);
+
+	void NightLightWrapper::getGammaRamp(const int16_t colorTemperature, uint16_t (&ramp)[3][256])
+	{
+		static_assert(sizeof(GammaRamp) == sizeof(ramp), "GammaRamp must match the SetDeviceGammaRamp layout");
+		memcpy(ramp, GammaRamp::get(colorTemperature).get(), sizeof(ramp));
+	}
+
+	const NightLightWrapper& NightLightWrapper::getSmoothenedColorTemperatures(int16_t* temperatures, const size_t count, const uint32_t frameInterval) const
+	{
+		_nl->getSmoothenedColorTemperatures(temperatures, count, frameInterval);
+		return *this;
+	}
 	NL_NONCHAINABLE_WRAPPER(const int16_t, getColorTemperature, const);
 	NL_NONCHAINABLE_WRAPPER(const int16_t, getDayColorTemperature, const noexcept);
 	NL_NONCHAINABLE_WRAPPER(const int16_t, getNightColorTemperature, const noexcept);
@@ -398,19 +977,111 @@ NightLightWrapper& NightLightWrapper::get##_name_##Time(int8_t& hours, int8_t& m
 	NL_CHAINABLE_WRAPPER(setNightColorTemperature, const int16_t, ct, );
 
 	NL_CHAINABLE_WRAPPER(save, const bool, dontTrigger, );
+
+	NightLightWrapper& NightLightWrapper::apply(const std::function<void(NightLightWrapper&)>& changes, const bool dontTrigger)
+	{
+		_nl->apply([&]() { changes(*this); }, dontTrigger);
+		return *this;
+	}
 	NL_CHAINABLE_WRAPPER(load, const bool, ignoreStatusChange, );
 
+	std::shared_future<void> NightLightWrapper::loadAsync(const bool ignoreStatusChange)
+	{
+		return _nl->loadAsync(ignoreStatusChange);
+	}
+
+	std::shared_future<void> NightLightWrapper::saveAsync(const bool dontTrigger)
+	{
+		return _nl->saveAsync(dontTrigger);
+	}
+
 	NL_CHAINABLE_WRAPPER(backup,,, );
 	NL_CHAINABLE_WRAPPER(restore,,, );
 
 	NightLightWrapper& NightLightWrapper::startWatching(const std::function<void(NightLightWrapper&)>& callback)
 	{
-		_nl->startWatching([&, callback](NightLight&) { callback(*this); });
+		_nl->startWatching([&, callback](NightLight&, const uint32_t) { callback(*this); });
+		return *this;
+	}
+
+	NightLightWrapper& NightLightWrapper::startWatching(const std::function<void(NightLightWrapper&, const uint32_t)>& callback)
+	{
+		_nl->startWatching([&, callback](NightLight&, const uint32_t changes) { callback(*this, changes); });
 		return *this;
 	}
 	NL_CHAINABLE_WRAPPER(stopWatching,,, noexcept);
 	NL_CHAINABLE_WRAPPER(pauseWatching,,, noexcept);
 	NL_CHAINABLE_WRAPPER(resumeWatching,,, noexcept);
 
+	NightLightWrapper& NightLightWrapper::setWatchCoalescing(const uint32_t quietPeriod, const uint32_t maxDelay) noexcept
+	{
+		_nl->setWatchCoalescing(quietPeriod, maxDelay);
+		return *this;
+	}
+
+	const bool NightLightWrapper::startRecording(const char* path, const uint32_t capacity)
+	{
+		return _nl->startRecording(path, capacity);
+	}
+
+	NL_CHAINABLE_WRAPPER(stopRecording,,, noexcept);
+	NL_NONCHAINABLE_WRAPPER(const bool, isRecording, const noexcept);
+
+	NightLightWrapper& NightLightWrapper::startScheduler(const std::function<void(NightLightWrapper&, const ScheduleEvent)>& callback)
+	{
+		_nl->startScheduler([&, callback](NightLight&, const ScheduleEvent event) { callback(*this, event); });
+		return *this;
+	}
+
+	NL_CHAINABLE_WRAPPER(stopScheduler,,, noexcept);
+
+	const bool NightLightWrapper::getNextScheduleEvent(ScheduleEvent& event, uint64_t& dueTime) const
+	{
+		return _nl->getNextScheduleEvent(event, dueTime);
+	}
+
+	void NightLightWrapper::getWatchCounters(uint64_t& wakeups, uint64_t& callbacks) noexcept
+	{
+		// read from the metrics so asking does not start the watcher service
+		const Metrics::WatchMetrics& metrics = Metrics::watch();
+		wakeups = metrics.wakeups;
+		callbacks = metrics.callbacks;
+	}
+
+	const uint64_t NightLightWrapper::getSkippedSaveCount() noexcept
+	{
+		return Settings::getSkippedSaveCount() + State::getSkippedSaveCount();
+	}
+
+	const bool NightLightWrapper::startCapture(const char* path)
+	{
+		return Registry::Corpus::startCapture(path);
+	}
+
+	void NightLightWrapper::stopCapture() noexcept
+	{
+		Registry::Corpus::stopCapture();
+	}
+
+	const bool NightLightWrapper::replayCorpus(const char* path, ReplayReport& report)
+	{
+		return NightLight::replayCorpus(path, report);
+	}
+
+	void NightLightWrapper::setWatchQueueCoalescing(const bool perKey) noexcept
+	{
+		Registry::DispatchQueue::instance().setOverflow(perKey ? Registry::Overflow::CoalescePerKey : Registry::Overflow::DropOldest);
+	}
+
+	void NightLightWrapper::shutdown() noexcept
+	{
+		Registry::shutdown();
+	}
+
+	Metrics::Snapshot NightLightWrapper::getMetrics()
+	{
+		return Metrics::snapshot();
+	}
+
 #pragma endregion NightLightWrapper
 } // namespace NightLightLibrary
\ No newline at end of file
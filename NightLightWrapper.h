@@ -1,16 +1,79 @@
 #pragma once
 #include <functional>
+#include <future>
+#include <memory>
+#include "Metrics.h"
 namespace NightLightLibrary
 {
+	// fields reported as changed to watch callbacks
+	namespace Field
+	{
+		constexpr uint32_t None				= 0;
+		// settings
+		constexpr uint32_t Enabled			= 1 << 0;
+		constexpr uint32_t OnSunSchedule	= 1 << 1;
+		constexpr uint32_t ManualSchedule	= 1 << 2;
+		constexpr uint32_t SunSchedule		= 1 << 3;
+		constexpr uint32_t ColorTemperature	= 1 << 4;
+		constexpr uint32_t Previewing		= 1 << 5;
+		// state
+		constexpr uint32_t Status			= 1 << 8;
+		constexpr uint32_t Trigger			= 1 << 9;
+		constexpr uint32_t ChangedOn		= 1 << 10;
+		constexpr uint32_t Usable			= 1 << 11;
+	} // namespace Field
+
+	// shape of the emulated color temperature transition
+	enum class TransitionCurve : uint8_t
+	{
+		Linear,		// linear in Kelvin
+		Mired,		// linear in mired, perceptually uniform
+		EaseInOut,	// smoothstep in mired
+		SCurve		// smootherstep in mired, close to the Windows transition
+	};
+
+	// instants reported to schedule callbacks
+	enum class ScheduleEvent : uint8_t
+	{
+		Start,			// scheduled period begins, the transition to the night temperature starts
+		End,			// scheduled period ends, the transition to the day temperature starts
+		TransitionEnd	// the transition started by the last Start or End is over
+	};
+
+	// outcome of NightLightWrapper::replayCorpus()
+	struct ReplayReport
+	{
+		uint64_t	blobs;				// entries replayed
+		uint64_t	decoded;			// loads that decoded their blob
+		uint64_t	unchanged;			// loads change detection skipped
+		uint64_t	failures;			// blobs that could not be decoded at all
+		uint64_t	unknown;			// entries of other subkeys
+		double		seconds;			// spent in loads
+		double		blobsPerSecond;
+		uint64_t	changes[32];		// per Field bit, changes reported by change detection
+		uint64_t	fieldFailures[32];	// per Field bit, decoded blobs where the schema codec and bond disagree
+	}; // struct ReplayReport
+
 	class NightLightWrapper
 	{
 	public:
 		NightLightWrapper();
 		~NightLightWrapper();
+		// runs the constructor, and its registry reads, on the library executor
+		static std::future<std::unique_ptr<NightLightWrapper>> createAsync();
 
 		static const bool isSupported(const bool checkEnabled = false);
 
+		// backend used by wrappers created afterwards, defaults to the registry, to memory outside Windows
+#ifdef _WIN32
+		static void useRegistryStore();
+#endif // _WIN32
+		static void useMemoryStore();
+		static void useFileStore(const char* directory);
+
 		const bool didStatusChange() const noexcept;
+		// bumped every time the values returned by the getters change, reading it never blocks
+		const uint64_t getVersion() const noexcept;
 
 		NightLightWrapper& disable() noexcept;
 		NightLightWrapper& enable() noexcept;
@@ -26,11 +89,16 @@ namespace NightLightLibrary
 		NightLightWrapper& useSunSchedule() noexcept;
 		NightLightWrapper& useManualSchedule() noexcept;
 		const bool isOnSunSchedule() const noexcept;
+		// sets the sun schedule to today's sunset and sunrise at the location, in degrees north and east
+		// all day during a polar night and empty during a polar day
+		// Windows only refreshes it on location updates, save() writes it
+		NightLightWrapper& updateSunSchedule(const double latitude, const double longitude);
 
 		NightLightWrapper& setStartTime(const int8_t hours, const int8_t minutes);
 		NightLightWrapper& setEndTime(const int8_t hours, const int8_t minutes);
 		NightLightWrapper& getStartTime(int8_t& hours, int8_t& minutes) noexcept;
 		NightLightWrapper& getEndTime(int8_t& hours, int8_t& minutes) noexcept;
+		// false for an empty schedule, one starting when it ends
 		const bool isWithinTimeRange() const;
 
 		const int16_t getColorTemperature() const;
@@ -39,19 +107,65 @@ namespace NightLightLibrary
 		NightLightWrapper& setNightColorTemperature(const int16_t ct);
 		// attempts to emulate color temperature transition
 		const int16_t getSmoothenedColorTemperature() const;
+		// fills temperatures for count frames frameInterval ms apart, starting now
+		const NightLightWrapper& getSmoothenedColorTemperatures(int16_t* temperatures, const size_t count, const uint32_t frameInterval) const;
+		NightLightWrapper& setTransitionCurve(const TransitionCurve curve) noexcept;
+		const TransitionCurve getTransitionCurve() const noexcept;
+		// gamma ramp in the SetDeviceGammaRamp layout, cached per temperature
+		static void getGammaRamp(const int16_t colorTemperature, uint16_t (&ramp)[3][256]);
 
 		const bool isPreviewing() const noexcept;
 		const bool wasPreviewing() const noexcept;
 
 		NightLightWrapper& save(const bool dontTrigger = true);
+		// applies the setters called by changes in one step: each record is written at most once,
+		// only if its content changed, and watching resumes after both writes
+		NightLightWrapper& apply(const std::function<void(NightLightWrapper&)>& changes, const bool dontTrigger = true);
 		NightLightWrapper& load(const bool ignoreStatusChange = false);
+		// load() and save() on the library executor, calls made before the queued operation starts share it
+		// the wrapper waits for its queued operations when destroyed
+		std::shared_future<void> loadAsync(const bool ignoreStatusChange = false);
+		std::shared_future<void> saveAsync(const bool dontTrigger = true);
 		NightLightWrapper& backup();
 		NightLightWrapper& restore();
 
 		NightLightWrapper& startWatching(const std::function<void(NightLightWrapper&)>& callback = [](NightLightWrapper&) noexcept {});
+		// callback also receives the Field mask of what changed
+		NightLightWrapper& startWatching(const std::function<void(NightLightWrapper&, const uint32_t)>& callback);
 		NightLightWrapper& stopWatching() noexcept;
 		NightLightWrapper& pauseWatching() noexcept;
 		NightLightWrapper& resumeWatching() noexcept;
+		// coalesce notification bursts: call back once keys were quiet for quietPeriod ms, but no later than maxDelay ms
+		// applies from the next startWatching(), 0 disables coalescing
+		NightLightWrapper& setWatchCoalescing(const uint32_t quietPeriod, const uint32_t maxDelay = 0) noexcept;
+		// process-wide, callbacks waiting behind a slow one are merged per key (the default)
+		// or all kept, the oldest being dropped once 256 are waiting
+		static void setWatchQueueCoalescing(const bool perKey) noexcept;
+		// stops the process-wide watch threads, to call before unloading the library, watching no longer works afterwards
+		static void shutdown() noexcept;
+		// calls back from a timer thread at the next scheduled switches and at the end of the transitions they start
+		// instead of polling isWithinTimeRange(), follows Settings changes, callbacks must not stop the scheduler
+		// Windows only, elsewhere the scheduler stays stopped
+		NightLightWrapper& startScheduler(const std::function<void(NightLightWrapper&, const ScheduleEvent)>& callback);
+		NightLightWrapper& stopScheduler() noexcept;
+		// dueTime is a UTC FILETIME, false when the scheduler is stopped or nothing is due
+		const bool getNextScheduleEvent(ScheduleEvent& event, uint64_t& dueTime) const;
+		// appends every change delivered to watch callbacks to a memory-mapped ring file, read it with History::open()
+		// false when the file cannot be opened or mapped, a recording already running then goes on
+		const bool startRecording(const char* path, const uint32_t capacity = 1 << 16);
+		NightLightWrapper& stopRecording() noexcept;
+		const bool isRecording() const noexcept;
+		// process-wide raw key notifications and delivered callbacks
+		static void getWatchCounters(uint64_t& wakeups, uint64_t& callbacks) noexcept;
+		// process-wide record saves skipped because the stored data was already identical
+		static const uint64_t getSkippedSaveCount() noexcept;
+		// dumps every value read from now on, as is, into a corpus file for replayCorpus()
+		static const bool startCapture(const char* path);
+		static void stopCapture() noexcept;
+		// loads each captured value through the regular load path and change detection, on a private store
+		static const bool replayCorpus(const char* path, ReplayReport& report);
+		// process-wide counters and latency histograms of record I/O, coding and watch callbacks
+		static Metrics::Snapshot getMetrics();
 	private:
 		class NightLight;
 		std::unique_ptr<NightLight> _nl;
@@ -0,0 +1,183 @@
+#pragma once
+#ifdef _WIN32
+#ifndef VC_EXTRALEAN
+#define VC_EXTRALEAN
+#include <Windows.h>
+#undef VC_EXTRALEAN
+#else
+#include <Windows.h>
+#endif // VC_EXTRALEAN
+#else // _WIN32
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <pthread.h>
+
+// the few Win32 types and calls the stores, records, their watchers, the sun schedule and the wrapper use
+// so they build without the Windows SDK, the registry parts stay Windows only
+typedef const char*			LPCSTR;
+typedef uint16_t			WORD;
+typedef uint32_t			DWORD;
+typedef unsigned long long	ULONGLONG;
+typedef int					BOOL;
+
+#ifndef FALSE
+#define FALSE	0
+#endif
+#ifndef TRUE
+#define TRUE	1
+#endif
+
+typedef struct _FILETIME
+{
+	DWORD	dwLowDateTime;
+	DWORD	dwHighDateTime;
+} FILETIME, *LPFILETIME;
+
+typedef struct _SYSTEMTIME
+{
+	WORD	wYear;
+	WORD	wMonth;
+	WORD	wDayOfWeek;
+	WORD	wDay;
+	WORD	wHour;
+	WORD	wMinute;
+	WORD	wSecond;
+	WORD	wMilliseconds;
+} SYSTEMTIME, *LPSYSTEMTIME;
+
+typedef union _ULARGE_INTEGER
+{
+	struct
+	{
+		DWORD	LowPart;
+		DWORD	HighPart;
+	};
+	ULONGLONG	QuadPart;
+} ULARGE_INTEGER;
+
+// only the system time zone, passed as NULL, is supported
+typedef struct _TIME_ZONE_INFORMATION TIME_ZONE_INFORMATION;
+
+#define UNREFERENCED_PARAMETER(P) (void)(P)
+
+constexpr int64_t FileTimeUnixEpoch = 11644473600LL; // 1970-01-01 in seconds since 1601-01-01
+
+// tm as filled by gmtime_r or localtime_r
+inline void toSystemTime(const tm& fields, const WORD milliseconds, LPSYSTEMTIME systemTime) noexcept
+{
+	systemTime->wYear = static_cast<WORD>(fields.tm_year + 1900);
+	systemTime->wMonth = static_cast<WORD>(fields.tm_mon + 1);
+	systemTime->wDayOfWeek = static_cast<WORD>(fields.tm_wday);
+	systemTime->wDay = static_cast<WORD>(fields.tm_mday);
+	systemTime->wHour = static_cast<WORD>(fields.tm_hour);
+	systemTime->wMinute = static_cast<WORD>(fields.tm_min);
+	systemTime->wSecond = static_cast<WORD>(fields.tm_sec);
+	systemTime->wMilliseconds = milliseconds;
+}
+
+// 100ns intervals since 1601-01-01 UTC
+inline void GetSystemTimeAsFileTime(LPFILETIME filetime) noexcept
+{
+	typedef std::chrono::duration<int64_t, std::ratio<1, 10000000>> Intervals;
+	const uint64_t now = FileTimeUnixEpoch * 10000000ULL + static_cast<uint64_t>(std::chrono::duration_cast<Intervals>(
+		std::chrono::system_clock::now().time_since_epoch()).count());
+	filetime->dwLowDateTime = static_cast<DWORD>(now);
+	filetime->dwHighDateTime = static_cast<DWORD>(now >> 32);
+}
+
+// ms since an unspecified start, monotonic like its Win32 counterpart
+inline ULONGLONG GetTickCount64() noexcept
+{
+	return static_cast<ULONGLONG>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline void GetLocalTime(LPSYSTEMTIME systemTime) noexcept
+{
+	const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+	const time_t seconds = std::chrono::system_clock::to_time_t(now);
+	tm local{};
+	localtime_r(&seconds, &local);
+	toSystemTime(local, static_cast<WORD>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		now.time_since_epoch()).count() % 1000), systemTime);
+}
+
+// wDayOfWeek is ignored, out of range fields fail rather than carry over
+inline BOOL SystemTimeToFileTime(const SYSTEMTIME* systemTime, LPFILETIME filetime) noexcept
+{
+	if (systemTime->wYear < 1601 || systemTime->wMonth < 1 || systemTime->wMonth > 12 || systemTime->wDay < 1 || systemTime->wDay > 31 ||
+		systemTime->wHour > 23 || systemTime->wMinute > 59 || systemTime->wSecond > 59 || systemTime->wMilliseconds > 999)
+		return FALSE;
+	tm fields{};
+	fields.tm_year = systemTime->wYear - 1900;
+	fields.tm_mon = systemTime->wMonth - 1;
+	fields.tm_mday = systemTime->wDay;
+	fields.tm_hour = systemTime->wHour;
+	fields.tm_min = systemTime->wMinute;
+	fields.tm_sec = systemTime->wSecond;
+	const time_t seconds = timegm(&fields);
+	if (fields.tm_mday != systemTime->wDay) // April 31st and the like
+		return FALSE;
+	const uint64_t value = (static_cast<uint64_t>(seconds + FileTimeUnixEpoch) * 1000 + systemTime->wMilliseconds) * 10000;
+	filetime->dwLowDateTime = static_cast<DWORD>(value);
+	filetime->dwHighDateTime = static_cast<DWORD>(value >> 32);
+	return TRUE;
+}
+
+inline BOOL FileTimeToSystemTime(const FILETIME* filetime, LPSYSTEMTIME systemTime) noexcept
+{
+	const uint64_t value = (static_cast<uint64_t>(filetime->dwHighDateTime) << 32) | filetime->dwLowDateTime;
+	const time_t seconds = static_cast<time_t>(value / 10000000) - FileTimeUnixEpoch;
+	tm fields{};
+	if (gmtime_r(&seconds, &fields) == nullptr)
+		return FALSE;
+	toSystemTime(fields, static_cast<WORD>(value % 10000000 / 10000), systemTime);
+	return TRUE;
+}
+
+inline BOOL SystemTimeToTzSpecificLocalTime(const TIME_ZONE_INFORMATION* timeZone, const SYSTEMTIME* utc, LPSYSTEMTIME local) noexcept
+{
+	FILETIME filetime;
+	if (timeZone != nullptr || !SystemTimeToFileTime(utc, &filetime))
+		return FALSE;
+	const time_t seconds = static_cast<time_t>(((static_cast<uint64_t>(filetime.dwHighDateTime) << 32) | filetime.dwLowDateTime) / 10000000) - FileTimeUnixEpoch;
+	tm fields{};
+	if (localtime_r(&seconds, &fields) == nullptr)
+		return FALSE;
+	toSystemTime(fields, utc->wMilliseconds, local);
+	return TRUE;
+}
+
+// recursive like its Win32 counterpart, a failure to lock is not reported there either
+typedef pthread_mutex_t		CRITICAL_SECTION, *LPCRITICAL_SECTION;
+
+inline void InitializeCriticalSection(LPCRITICAL_SECTION section) noexcept
+{
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(section, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+}
+
+inline void DeleteCriticalSection(LPCRITICAL_SECTION section) noexcept
+{
+	pthread_mutex_destroy(section);
+}
+
+inline void EnterCriticalSection(LPCRITICAL_SECTION section) noexcept
+{
+	pthread_mutex_lock(section);
+}
+
+inline BOOL TryEnterCriticalSection(LPCRITICAL_SECTION section) noexcept
+{
+	return pthread_mutex_trylock(section) == 0 ? TRUE : FALSE;
+}
+
+inline void LeaveCriticalSection(LPCRITICAL_SECTION section) noexcept
+{
+	pthread_mutex_unlock(section);
+}
+#endif // _WIN32
@@ -0,0 +1,111 @@
+#include "stdafx.h"
+#include "ProfileManager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <system_error>
+#include <thread>
+
+namespace NightLightLibrary
+{
+#ifdef _WIN32
+	std::vector<std::string> ProfileManager::enumerateProfiles()
+	{
+		constexpr char UserSidPrefix[] = "S-1-5-21-"; // local and domain accounts, not the service accounts
+		constexpr char ClassesSuffix[] = "_Classes";
+		std::vector<std::string> profiles;
+		char name[256];
+		for (DWORD index = 0;; index++) {
+			DWORD size = sizeof(name);
+			if (::RegEnumKeyExA(HKEY_USERS, index, name, &size, NULL, NULL, NULL, NULL) != ERROR_SUCCESS)
+				break;
+			const std::string sid(name, size);
+			if (sid.compare(0, sizeof(UserSidPrefix) - 1, UserSidPrefix) != 0)
+				continue;
+			if (sid.size() >= sizeof(ClassesSuffix) - 1 && sid.compare(sid.size() - (sizeof(ClassesSuffix) - 1), std::string::npos, ClassesSuffix) == 0)
+				continue;
+			profiles.push_back(sid);
+		}
+		return profiles;
+	}
+#endif // _WIN32
+
+	ProfileManager::ProfileManager(const std::vector<std::string>& profiles, const size_t threads, const StoreFactory& factory)
+		: _profiles(profiles), _threads(std::max<size_t>(threads, 1)), _factory(factory)
+	{
+	}
+
+	std::vector<ProfileReport> ProfileManager::run(const Changes& changes) const
+	{
+		std::vector<ProfileReport> reports(_profiles.size());
+		// workers take the next profile until none is left
+		std::atomic<size_t> next{ 0 };
+		const auto work = [&]() {
+			for (size_t i = next++; i < _profiles.size(); i = next++)
+				reports[i] = runProfile(_profiles[i], changes ? &changes : nullptr);
+		};
+		std::vector<std::thread> workers;
+		const size_t count = std::min(_threads, _profiles.size());
+		workers.reserve(count);
+		for (size_t i = 1; i < count; i++) {
+			try
+			{
+				workers.emplace_back(work);
+			}
+			catch (const std::system_error&)
+			{
+				break; // the workers already started, and the caller, take the rest
+			}
+		}
+		work(); // the caller is one of the workers
+		for (std::thread& worker : workers)
+			worker.join();
+		return reports;
+	}
+
+	std::vector<ProfileReport> ProfileManager::load() const
+	{
+		return run(nullptr);
+	}
+
+	ProfileReport ProfileManager::runProfile(const std::string& profile, const Changes* changes) const
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ProfileReport report;
+		try
+		{
+			report.profile = profile;
+			const std::shared_ptr<Registry::Store> store = _factory(profile);
+			Settings settings;
+			State state;
+			// stores are not shared between profiles, entries would only add watchers
+			settings._shareCache = false;
+			state._shareCache = false;
+			settings.setStore(store);
+			state.setStore(store);
+			report.loaded = store && Settings::load(settings) && State::load(state);
+			if (report.loaded && changes != nullptr) {
+				(*changes)(profile, settings, state);
+				settings.save();
+				state.save();
+				report.saved = !settings._dirty && !state._dirty;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			// escaping a worker thread would terminate the process
+			report.failed = true;
+#ifdef _DEBUG
+			std::cout << "[ProfileManager] " << profile << ": " << e.what() << std::endl;
+#else // _DEBUG
+			UNREFERENCED_PARAMETER(e);
+#endif // _DEBUG
+		}
+		catch (...)
+		{
+			report.failed = true;
+		}
+		report.duration = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+		return report;
+	}
+} // namespace NightLightLibrary
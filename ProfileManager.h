@@ -0,0 +1,52 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Settings.h"
+#include "State.h"
+
+namespace NightLightLibrary
+{
+	// outcome for one profile of ProfileManager::run()
+	struct ProfileReport
+	{
+		std::string	profile;
+		bool		loaded{ false };	// both records read and decoded
+		bool		saved{ false };		// both records written, or already stored
+		bool		failed{ false };	// the store factory, a load, the changes or a save threw
+		uint64_t	duration{ 0 };		// microseconds spent on the profile
+	}; // struct ProfileReport
+
+	// loads, changes and saves Settings and State of many profiles, a bounded number at a time
+	class ProfileManager
+	{
+	public:
+		typedef std::function<std::shared_ptr<Registry::Store>(const std::string& profile)> StoreFactory;
+		typedef std::function<void(const std::string& profile, Settings& settings, State& state)> Changes;
+
+#ifdef _WIN32
+		// SIDs of the user hives loaded under HKEY_USERS
+		static std::vector<std::string> enumerateProfiles();
+
+		// stores default to the profile's hive, any other backend can stand in for it
+		ProfileManager(const std::vector<std::string>& profiles, const size_t threads = 4,
+			const StoreFactory& factory = [](const std::string& profile) { return Registry::RegistryStore::forProfile(profile); });
+#else // _WIN32
+		// no hives outside Windows, every store comes from factory
+		ProfileManager(const std::vector<std::string>& profiles, const size_t threads, const StoreFactory& factory);
+#endif // _WIN32
+
+		// loads every profile, then runs changes and saves the records they made dirty
+		// reports come in the order of the profiles, a profile that throws is reported failed and the others go on
+		std::vector<ProfileReport> run(const Changes& changes) const;
+		// loads every profile without saving anything
+		std::vector<ProfileReport> load() const;
+	private:
+		const std::vector<std::string>	_profiles;
+		const size_t					_threads;
+		const StoreFactory				_factory;
+
+		ProfileReport runProfile(const std::string& profile, const Changes* changes) const;
+	}; // class ProfileManager
+} // namespace NightLightLibrary
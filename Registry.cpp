@@ -1,177 +1,595 @@
 #include "stdafx.h"
 #include "Registry.h"
+#include <algorithm>
 
 namespace NightLightLibrary
 {
 	namespace Registry
 	{
-		class Exception : public std::exception
+#ifdef _WIN32
+#pragma region WatcherService
+
+		struct WatcherService::Key
 		{
-		public:
-			Exception(const char* const m = "") noexcept : message(m) {}
-			const char* what() const noexcept override { return message; }
-		private:
-			const char* message;
+			HKEY		root{ NULL };
+			std::string	subKey;
+			HKEY		key{ NULL };
+			HANDLE		event{ NULL };
+			bool		armed{ false };		// watcher thread only
+			std::atomic<bool>	failed{ false };	// could not be armed or waited on, no longer watched
+
+			~Key()
+			{
+				if (key != NULL)
+					::RegCloseKey(key);
+				if (event != NULL)
+					::CloseHandle(event);
+			}
 		};
 
+		struct WatcherService::Subscription
+		{
+			Id			id{ 0 };
+			std::shared_ptr<Key> key;
+			std::function<void(LPCSTR)> callback;
+			Coalescing	coalescing;
+			bool		immediate{ false };
+			bool		pending{ false };	// watcher thread only, a coalesced callback is due at deadline
+			ULONGLONG	burstStart{ 0 };	// watcher thread only
+			ULONGLONG	deadline{ 0 };		// watcher thread only
+			std::chrono::steady_clock::time_point notified;	// watcher thread only, first notification not yet delivered
+			std::atomic<bool>	queued{ false };	// a callback waits in the DispatchQueue
+			std::atomic<bool>	active{ true };		// cleared by unsubscribe()
+			std::atomic<bool>	inFlight{ false };	// its callback is running
+		};
 
-#pragma region Watcher
+		WatcherService& WatcherService::instance()
+		{
+			static WatcherService service;
+			return service;
+		}
 
-		Watcher::~Watcher()
+		WatcherService::WatcherService()
 		{
-			stop();
+			DispatchQueue::instance(); // outlives the service, whose thread posts to it
+			_wakeEvent = ::CreateEventA(NULL, FALSE, FALSE, NULL); // auto reset
 		}
 
-		const bool Watcher::isWatching() const noexcept
+		WatcherService::~WatcherService()
 		{
-			return _watching;
+			shutdown();
+			if (_wakeEvent != NULL)
+				::CloseHandle(_wakeEvent);
 		}
 
-		void Watcher::setWatching(const bool w) noexcept
+		void WatcherService::shutdown() noexcept
 		{
-			_watching = w;
+			std::vector<std::shared_ptr<Subscription>> subscriptions;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+				subscriptions.swap(_subscriptions);
+				_keys.clear();
+				_changed = true;
+			}
+			if (_wakeEvent != NULL)
+				::SetEvent(_wakeEvent);
+			if (_thread.joinable())
+				_thread.join();
+			for (const std::shared_ptr<Subscription>& subscription : subscriptions)
+				retire(subscription);
 		}
 
-		void Watcher::start(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback)
+		const WatcherService::Id WatcherService::subscribe(const HKEY root, const LPCSTR subKey, const std::function<void(LPCSTR)>& callback, const Coalescing& coalescing, const bool immediate)
 		{
-			if (isWatching() || subKeys.size() < 1)
-				return;
-			setWatching(true);
-			std::thread(&Watcher::watchLoop, this, subKeys, callback).detach();
+			if (_wakeEvent == NULL)
+				return 0;
+
+			std::shared_ptr<Subscription> subscription = std::make_shared<Subscription>();
+			subscription->callback = callback;
+			subscription->coalescing = coalescing;
+			subscription->immediate = immediate;
+
+			// the key is opened outside the lock, another subscribe may add the same key meanwhile
+			std::shared_ptr<Key> opened;
+			std::thread previous;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				for (;;) {
+					if (_stopping)
+						return 0;
+					size_t waited = 0;
+					for (const std::shared_ptr<Key>& key : _keys) {
+						if (key->failed)
+							continue; // a new subscription gets a new handle
+						waited++;
+						if (key->root == root && key->subKey == subKey)
+							subscription->key = key;
+					}
+					if (subscription->key)
+						break; // a key opened meanwhile is dropped, its handles closed by ~Key
+					// one wait slot is taken by the wake event, a key past the last slot would never be waited on
+					if (waited + 1 >= MAXIMUM_WAIT_OBJECTS)
+						return 0;
+					if (opened) {
+						_keys.push_back(opened);
+						subscription->key = opened;
+						break;
+					}
+					lock.unlock();
+					opened = std::make_shared<Key>();
+					opened->root = root;
+					opened->subKey = subKey;
+					if (::RegOpenKeyExA(root, subKey, 0, KEY_NOTIFY, &(opened->key)) != ERROR_SUCCESS) {
+						opened->key = NULL;
+						return 0;
+					}
+					opened->event = ::CreateEventA(NULL, FALSE, FALSE, NULL); // auto reset
+					if (opened->event == NULL)
+						return 0;
+					lock.lock();
+				}
+				subscription->id = ++_lastId;
+				_subscriptions.push_back(subscription);
+				_changed = true;
+				if (_running)
+					::SetEvent(_wakeEvent);
+				else {
+					// the previous thread ran out of subscriptions, it leaves nothing to do after clearing _running
+					previous = std::move(_thread);
+					_running = true;
+					_thread = std::thread(&WatcherService::watchLoop, this);
+				}
+			}
+			if (previous.joinable())
+				previous.join();
+			return subscription->id;
 		}
 
-		const bool Watcher::isPaused() const noexcept
+		void WatcherService::unsubscribe(const Id id) noexcept
 		{
-			return _paused;
+			std::shared_ptr<Subscription> subscription;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				for (auto it = _subscriptions.begin(); it != _subscriptions.end(); it++) {
+					if ((*it)->id == id) {
+						subscription = *it;
+						_subscriptions.erase(it);
+						_changed = true;
+						break;
+					}
+				}
+				if (!subscription)
+					return;
+				// the key goes with its last subscription
+				bool shared = false;
+				for (const std::shared_ptr<Subscription>& other : _subscriptions)
+					shared = shared || other->key == subscription->key;
+				if (!shared)
+					_keys.erase(std::remove(_keys.begin(), _keys.end(), subscription->key), _keys.end());
+			}
+			retire(subscription);
+			// the watcher thread drops its reference (and the handles) when it rebuilds its wait list
+			::SetEvent(_wakeEvent);
 		}
 
-		void Watcher::setPaused(const bool p) noexcept
+		void WatcherService::retire(const std::shared_ptr<Subscription>& subscription) noexcept
 		{
-			_paused = p;
+			// pairs with dispatch() setting inFlight before it checks active
+			subscription->active = false;
+			// a callback unsubscribing itself, or another key, cannot wait on the thread it runs on
+			if (DispatchQueue::isCallbackThread())
+				return;
+			while (subscription->inFlight)
+				std::this_thread::yield();
 		}
 
-		void Watcher::pause() noexcept
+		const uint64_t WatcherService::getWakeupCount() const noexcept
 		{
-			setPaused(true);
+			return Metrics::watch().wakeups;
 		}
 
-		void Watcher::resume() noexcept
+		const uint64_t WatcherService::getCallbackCount() const noexcept
 		{
-			setPaused(false);
+			return Metrics::watch().callbacks;
 		}
 
-		void Watcher::stop() noexcept
+		const size_t WatcherService::getSubscriptionCount() const noexcept
 		{
-			if (!isWatching())
-				return;
-			setWatching(false);
-			_lastBreathEvent = ::CreateEventA(NULL, TRUE, FALSE, NULL);
-			if (_cancelEvent != NULL)
-				::SetEvent(_cancelEvent);
-			::WaitForSingleObject(_lastBreathEvent, INFINITE);
-			::CloseHandle(_lastBreathEvent);
-			_lastBreathEvent = NULL;
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _subscriptions.size();
 		}
 
-		const int Watcher::watch(std::vector<HANDLE>& events, std::vector<HKEY>& keys)
+		const size_t WatcherService::getKeyCount() const noexcept
 		{
-			// https://docs.microsoft.com/en-us/windows/desktop/sync/waiting-for-multiple-objects
-			// https://docs.microsoft.com/en-us/windows/desktop/api/winreg/nf-winreg-regnotifychangekeyvalue
-			int changedKeyIndex = -1;
-			for (size_t idx = 0; idx < keys.size(); idx++) {
-				constexpr DWORD dwFilter = REG_NOTIFY_CHANGE_LAST_SET | // reports even when value unchanged
-					//REG_NOTIFY_CHANGE_NAME |
-					//REG_NOTIFY_CHANGE_ATTRIBUTES |
-					//REG_NOTIFY_CHANGE_SECURITY |
-					REG_NOTIFY_THREAD_AGNOSTIC;
-				// Watch the registry key for a change of value.
-				LSTATUS lErrorCode = ::RegNotifyChangeKeyValue(
-					keys[idx],
-					TRUE,
-					dwFilter,
-					events[idx],
-					TRUE); // async
-				if (lErrorCode != ERROR_SUCCESS)
-					throw Exception("Error in RegNotifyChangeKeyValue");
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _keys.size();
+		}
+
+		const bool WatcherService::isFailed(const Id id) const noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (const std::shared_ptr<Subscription>& subscription : _subscriptions) {
+				if (subscription->id == id)
+					return subscription->key->failed;
 			}
+			return true;
+		}
 
-			const DWORD triggeredEventIdx = ::WaitForMultipleObjects(
-				static_cast<DWORD>(events.size()),  // number of objects in array
-				events.data(),      // array of objects
-				FALSE,       // wait for any object
-				INFINITE);   // wait forever
-			const size_t cancelEventIdx = WAIT_OBJECT_0 + events.size() - 1;
-			if (triggeredEventIdx >= WAIT_OBJECT_0 && triggeredEventIdx < cancelEventIdx) { // one of the regkeys was changed
-				changedKeyIndex = triggeredEventIdx - WAIT_OBJECT_0;
+		void WatcherService::fail(Key& key) noexcept
+		{
 #ifdef _DEBUG
-				std::cout << "Key index changed : [" << changedKeyIndex << "]" << std::endl;
+			std::cout << "Key no longer watched : [" << key.subKey << "] (" << ::GetLastError() << ")." << std::endl;
 #endif // _DEBUG
-				// delay events reset and callback() to buffer triggers in quick successions
-				//std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			key.failed = true;
+			key.armed = false;
+			Metrics::watch().watchFailures++;
+		}
+
+		void WatcherService::post(const std::shared_ptr<Subscription>& subscription)
+		{
+			const std::chrono::steady_clock::time_point notified = subscription->notified;
+			DispatchQueue::instance().post([subscription, notified]() { dispatch(subscription, notified); }, &subscription->queued);
+		}
+
+		void WatcherService::dispatch(const std::shared_ptr<Subscription>& subscription, const std::chrono::steady_clock::time_point notified)
+		{
+			subscription->inFlight = true;
+			if (subscription->active) {
+#ifdef _DEBUG
+				std::cout << "Key changed : [" << subscription->key->subKey << "]" << std::endl;
+#endif // _DEBUG
+				Metrics::WatchMetrics& metrics = Metrics::watch();
+				metrics.callbacks++;
+				metrics.notifyToCallback.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - notified).count()));
+				Metrics::ScopedTimer timer(metrics.callback);
+				subscription->callback(subscription->key->subKey.c_str());
 			}
-			else if (triggeredEventIdx == cancelEventIdx) // cancel event triggered
-				setWatching(false); // break the loop
-			else
-				throw Exception("Wait event error");
+			subscription->inFlight = false;
+		}
 
-			for (HANDLE& event : events)
-				::ResetEvent(event);
-			return changedKeyIndex;
+		void WatcherService::dispatchImmediate(const std::shared_ptr<Subscription>& subscription)
+		{
+			subscription->inFlight = true;
+			if (subscription->active)
+				subscription->callback(subscription->key->subKey.c_str());
+			subscription->inFlight = false;
 		}
 
-		void Watcher::watchLoop(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback)
+		void WatcherService::watchLoop()
 		{
+			// https://docs.microsoft.com/en-us/windows/desktop/sync/waiting-for-multiple-objects
+			// https://docs.microsoft.com/en-us/windows/desktop/api/winreg/nf-winreg-regnotifychangekeyvalue
+			std::vector<Watched> watched;
+			std::vector<Watched*> waited;	// watched keys not failed, in event order
 			std::vector<HANDLE> events;
-			std::vector<HKEY>   keys;
-			try
-			{
-				for (const LPCSTR& subKey : subKeys) {
-					HKEY key;
-					LSTATUS lErrorCode = ::RegOpenKeyExA(HKEY_CURRENT_USER, subKey, 0, KEY_NOTIFY, &key);
-					if (lErrorCode != ERROR_SUCCESS)
-						throw Exception("Error in RegOpenKeyExA");
-					keys.push_back(key);
-
-					HANDLE event = ::CreateEventA(NULL, TRUE, FALSE, NULL);
-					if (event == NULL)
-						throw Exception("Error in CreateEvent");
-					events.push_back(event);
+			for (;;) {
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					if (_stopping || _subscriptions.empty()) {
+						// in the same lock as the check, a subscribe after it starts a new thread
+						// a restarted thread has to re-arm every key
+						for (const Watched& entry : watched) {
+							entry.key->armed = false;
+							for (const std::shared_ptr<Subscription>& subscription : entry.subscriptions)
+								subscription->pending = false;
+						}
+						_running = false;
+						break;
+					}
+					if (_changed) {
+						watched.clear();
+						for (const std::shared_ptr<Key>& key : _keys) {
+							watched.push_back({ key, {} });
+							for (const std::shared_ptr<Subscription>& subscription : _subscriptions) {
+								if (subscription->key == key)
+									watched.back().subscriptions.push_back(subscription);
+							}
+						}
+						_changed = false;
+					}
 				}
-				_cancelEvent = ::CreateEventA(NULL, TRUE, FALSE, NULL);
-				if (_cancelEvent == NULL)
-					throw Exception("Error in CreateEvent");
-				events.push_back(_cancelEvent); // make cancel event last in the list
-
-				while (isWatching()) {
-					const int subkeyIndex = watch(events, keys);
-					if (!isPaused() && subkeyIndex > -1 && subkeyIndex < subKeys.size()) {
+
+				// a key that cannot be armed is dropped from the wait list, the others keep being watched
+				waited.clear();
+				events.clear();
+				events.push_back(_wakeEvent); // wake event first, key events follow in key order
+				for (Watched& entry : watched) {
+					if (entry.key->failed)
+						continue;
+					if (!entry.key->armed) {
+						constexpr DWORD dwFilter = REG_NOTIFY_CHANGE_LAST_SET | // reports even when value unchanged
+							//REG_NOTIFY_CHANGE_NAME |
+							//REG_NOTIFY_CHANGE_ATTRIBUTES |
+							//REG_NOTIFY_CHANGE_SECURITY |
+							REG_NOTIFY_THREAD_AGNOSTIC;
+						// Watch the registry key for a change of value.
+						const LSTATUS lErrorCode = ::RegNotifyChangeKeyValue(
+							entry.key->key,
+							TRUE,
+							dwFilter,
+							entry.key->event,
+							TRUE); // async
+						if (lErrorCode != ERROR_SUCCESS) {
+							::SetLastError(static_cast<DWORD>(lErrorCode));
+							fail(*entry.key);
+							continue;
+						}
+						entry.key->armed = true;
+					}
+					waited.push_back(&entry);
+					events.push_back(entry.key->event);
+				}
+
+				// sleep until the earliest coalesced callback is due
+				DWORD timeout = INFINITE;
+				ULONGLONG now = ::GetTickCount64();
+				for (const Watched& entry : watched) {
+					for (const std::shared_ptr<Subscription>& subscription : entry.subscriptions) {
+						if (subscription->pending)
+							timeout = std::min<DWORD>(timeout, subscription->deadline > now ? static_cast<DWORD>(subscription->deadline - now) : 0);
+					}
+				}
+
+				const DWORD triggeredEventIdx = ::WaitForMultipleObjects(
+					static_cast<DWORD>(events.size()),  // number of objects in array
+					events.data(),      // array of objects
+					FALSE,       // wait for any object
+					timeout);
+				now = ::GetTickCount64();
+				if (triggeredEventIdx > WAIT_OBJECT_0 && triggeredEventIdx < WAIT_OBJECT_0 + events.size()) {
+					const size_t changedKeyIndex = triggeredEventIdx - WAIT_OBJECT_0 - 1;
 #ifdef _DEBUG
-						std::cout << "Key changed : [" << subKeys[subkeyIndex] << "]" << std::endl;
+					std::cout << "Key index changed : [" << changedKeyIndex << "]" << std::endl;
 #endif // _DEBUG
-						callback(subKeys[subkeyIndex]);
+					const Watched& entry = *waited[changedKeyIndex];
+					entry.key->armed = false; // notifications are one-shot
+					Metrics::watch().wakeups++;
+					// immediate callbacks first, so caches are invalidated before anyone is told to reload
+					for (const std::shared_ptr<Subscription>& subscription : entry.subscriptions) {
+						if (subscription->immediate)
+							dispatchImmediate(subscription);
+					}
+					for (const std::shared_ptr<Subscription>& subscription : entry.subscriptions) {
+						if (subscription->immediate)
+							continue;
+						if (!subscription->pending)
+							subscription->notified = std::chrono::steady_clock::now();
+						if (subscription->coalescing.quietPeriod == 0)
+							post(subscription);
+						else {
+							// (re)start the quiet period, bounded by the burst's max delay
+							if (!subscription->pending) {
+								subscription->pending = true;
+								subscription->burstStart = now;
+							}
+							subscription->deadline = now + subscription->coalescing.quietPeriod;
+							if (subscription->coalescing.maxDelay != 0)
+								subscription->deadline = std::min(subscription->deadline, subscription->burstStart + subscription->coalescing.maxDelay);
+						}
+					}
+				}
+				else if (triggeredEventIdx == WAIT_FAILED) {
+					// an event handle went bad, fail its key rather than the whole thread
+					bool found = false;
+					for (Watched* entry : waited) {
+						if (::WaitForSingleObject(entry->key->event, 0) == WAIT_FAILED) {
+							fail(*entry->key);
+							found = true;
+						}
+					}
+					if (!found)
+						::Sleep(100); // the wake event itself, keep the loop from spinning
+				}
+				// the wake event only rebuilds the list
+
+				for (const Watched& entry : watched) {
+					for (const std::shared_ptr<Subscription>& subscription : entry.subscriptions) {
+						if (subscription->pending && subscription->deadline <= now) {
+							subscription->pending = false;
+							post(subscription);
+						}
 					}
 				}
 			}
-			catch (const Exception& e)
-			{
-#ifdef _DEBUG
-				std::cout << e.what() << " (" << ::GetLastError() << ")." << std::endl;
-#else // _DEBUG
-				UNREFERENCED_PARAMETER(e);
-#endif // _DEBUG
+		}
+
+#pragma endregion WatcherService
+
+
+#pragma region RegistryWatcher
+
+		RegistryWatcher::~RegistryWatcher()
+		{
+			stop();
+		}
+
+		const bool RegistryWatcher::isWatching() const noexcept
+		{
+			// false once every key failed
+			for (const WatcherService::Id& id : _subscriptions) {
+				if (!WatcherService::instance().isFailed(id))
+					return true;
+			}
+			return false;
+		}
+
+		void RegistryWatcher::start(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback)
+		{
+			if (!_subscriptions.empty() || subKeys.size() < 1)
+				return;
+			const std::function<void(LPCSTR)> wrapper = [this, callback](LPCSTR subKey) {
+				if (!isPaused())
+					callback(subKey);
+			};
+			for (const LPCSTR& subKey : subKeys) {
+				const std::string key = _prefix.empty() ? std::string(subKey) : _prefix + "\\" + subKey;
+				const WatcherService::Id id = WatcherService::instance().subscribe(_root, key.c_str(), wrapper, _coalescing, _immediate);
+				if (id != 0)
+					_subscriptions.push_back(id);
+			}
+		}
+
+		void RegistryWatcher::setCoalescing(const Coalescing& coalescing) noexcept
+		{
+			_coalescing = coalescing;
+		}
+
+		void RegistryWatcher::setImmediate(const bool immediate) noexcept
+		{
+			_immediate = immediate;
+		}
+
+		const bool RegistryWatcher::isPaused() const noexcept
+		{
+			return _paused;
+		}
+
+		void RegistryWatcher::setPaused(const bool p) noexcept
+		{
+			_paused = p;
+		}
+
+		void RegistryWatcher::pause() noexcept
+		{
+			setPaused(true);
+		}
+
+		void RegistryWatcher::resume() noexcept
+		{
+			setPaused(false);
+		}
+
+		void RegistryWatcher::stop() noexcept
+		{
+			for (const WatcherService::Id& id : _subscriptions)
+				WatcherService::instance().unsubscribe(id);
+			_subscriptions.clear();
+		}
+
+#pragma endregion RegistryWatcher
+#endif // _WIN32
+
+
+#pragma region RecordCache
+
+		const uint64_t RecordCache::Entry::getVersion() const noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _version;
+		}
+
+		const bool RecordCache::Entry::isFresh() const noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _fresh;
+		}
+
+		const bool RecordCache::Entry::holds(const uint64_t hash) const noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _fresh && _value.hash == hash;
+		}
+
+		const bool RecordCache::Entry::get(Value& value) const
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (!_fresh)
+				return false;
+			value = _value;
+			return true;
+		}
+
+		void RecordCache::Entry::put(const uint64_t version, Value&& value)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (version != _version)
+				return; // the store changed while value was read
+			_value = std::move(value);
+			_fresh = true;
+		}
+
+		void RecordCache::Entry::invalidate() noexcept
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_version++;
+			_fresh = false;
+			_value.data.reset();
+		}
+
+		RecordCache& RecordCache::instance()
+		{
+			static RecordCache cache;
+			return cache;
+		}
+
+		std::shared_ptr<RecordCache::Entry> RecordCache::acquire(const std::shared_ptr<Store>& store, const LPCSTR subKey, const LPCSTR valueName)
+		{
+			if (!store)
+				return nullptr;
+			const Key key(store.get(), subKey);
+			std::lock_guard<std::mutex> lock(_mutex);
+			const auto found = _entries.find(key);
+			if (found != _entries.end()) {
+				std::shared_ptr<Entry> entry = found->second.lock();
+				if (entry)
+					return entry;
+			}
+
+			// watched before its first value is read, so no change can go unnoticed
+			std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+			entry->_watcher = store->createWatcher(valueName);
+			if (!entry->_watcher)
+				return nullptr;
+			Entry* const target = entry.get();
+			// invalidated on the watcher thread, ahead of the callbacks telling records to reload
+			entry->_watcher->setImmediate(true);
+			entry->_watcher->start({ subKey }, [target](LPCSTR) { target->invalidate(); });
+			if (!entry->_watcher->isWatching())
+				return nullptr;
+
+			for (auto it = _entries.begin(); it != _entries.end();) {
+				if (it->second.expired())
+					it = _entries.erase(it);
+				else
+					it++;
 			}
-			for (HKEY& key : keys)
-				::CloseHandle(key);
+			_entries[key] = entry;
+			return entry;
+		}
 
-			for (HANDLE& event : events) // close all events, including "cancel"
-				::CloseHandle(event);
-			_cancelEvent = NULL;
+		std::shared_ptr<RecordCache::Entry> RecordCache::find(const std::shared_ptr<Store>& store, const LPCSTR subKey)
+		{
+			if (!store)
+				return nullptr;
+			std::lock_guard<std::mutex> lock(_mutex);
+			const auto found = _entries.find(Key(store.get(), subKey));
+			return found != _entries.end() ? found->second.lock() : nullptr;
+		}
 
-			if (_lastBreathEvent != NULL)
-				::SetEvent(_lastBreathEvent);
+		const size_t RecordCache::getEntryCount()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			size_t count = 0;
+			for (const auto& entry : _entries) {
+				if (!entry.second.expired())
+					count++;
+			}
+			return count;
 		}
 
-#pragma endregion Watcher
+#pragma endregion RecordCache
+
+
+		void shutdown() noexcept
+		{
+			// the service posts to the queue, it goes first
+#ifdef _WIN32
+			WatcherService::instance().shutdown();
+#endif // _WIN32
+			DispatchQueue::instance().shutdown();
+		}
 
 	} // namespace Registry
 } // namespace NightLightLibrary
\ No newline at end of file
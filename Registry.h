@@ -1,13 +1,13 @@
 #pragma once
-#ifndef VC_EXTRALEAN
-#define VC_EXTRALEAN
-#include <Windows.h>
-#undef VC_EXTRALEAN
-#else
-#include <Windows.h>
-#endif // VC_EXTRALEAN
+#include "Platform.h"
 #include <bond/core/bond.h>
 #include <bond/stream/input_buffer.h>
+#include "Store.h"
+#include "Watcher.h"
+#include "CompactBinary.h"
+#include "Metrics.h"
+#include "Corpus.h"
+#include "DispatchQueue.h"
 #ifdef _DEBUG
 #include <iomanip>
 #endif
@@ -16,30 +16,104 @@ namespace NightLightLibrary
 {
 	namespace Registry
 	{
-		class Watcher
+#ifdef _WIN32
+		// process-wide watcher, multiplexes every subscribed key on a single thread
+		// subscriptions to the same key share its handle and wait slot
+		// the thread starts with the first subscription and exits after the last one is removed
+		// callbacks run on the DispatchQueue thread, keys are re-armed without waiting for them
+		class WatcherService
 		{
 		public:
-			Watcher() {};
-			~Watcher();
-			Watcher(const Watcher&) = delete;
-			Watcher& operator=(const Watcher&) = delete;
-			const bool isWatching() const noexcept;
-			void start(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback);
-			void stop() noexcept;
-			const bool isPaused() const noexcept;
-			void pause() noexcept;
-			void resume() noexcept;
+			typedef uint64_t Id;
+
+			static WatcherService& instance();
+			// calls shutdown(), which can deadlock on the loader lock when run from a DLL's static destructors
+			~WatcherService();
+			WatcherService(const WatcherService&) = delete;
+			WatcherService& operator=(const WatcherService&) = delete;
+
+			// returns 0 when the key cannot be watched or MAXIMUM_WAIT_OBJECTS - 1 keys already are
+			// an immediate callback runs on the watcher thread as soon as the key changes, before the key's other callbacks
+			// are queued, it is neither coalesced nor counted and must be short, must not block and must not unsubscribe
+			const Id subscribe(const HKEY root, const LPCSTR subKey, const std::function<void(LPCSTR)>& callback, const Coalescing& coalescing = {}, const bool immediate = false);
+			// once this returns the callback is not running, unless called from it, and will not be called again
+			void unsubscribe(const Id id) noexcept;
+			// unsubscribes every key and stops the thread, later subscriptions fail
+			void shutdown() noexcept;
+			const size_t getSubscriptionCount() const noexcept;
+			// distinct keys waited on
+			const size_t getKeyCount() const noexcept;
+			// true once the subscription's key could not be re-armed or waited on, it is no longer watched
+			// and only that key is affected, subscribing again opens a new handle
+			const bool isFailed(const Id id) const noexcept;
+			// raw key notifications received
+			const uint64_t getWakeupCount() const noexcept;
+			// callbacks delivered, lower than wakeups when bursts are coalesced
+			const uint64_t getCallbackCount() const noexcept;
 		private:
-			std::atomic<HANDLE> _cancelEvent{ NULL };
-			std::atomic<HANDLE> _lastBreathEvent{ NULL };
-			std::atomic<bool>   _watching{ false };
+			struct Key;
+			struct Subscription;
+
+			// a key and its subscriptions, as seen by the watcher thread
+			struct Watched
+			{
+				std::shared_ptr<Key>	key;
+				std::vector<std::shared_ptr<Subscription>> subscriptions;
+			}; // struct Watched
+
+			WatcherService();
+
+			mutable std::mutex		_mutex;
+			std::vector<std::shared_ptr<Subscription>> _subscriptions;
+			std::vector<std::shared_ptr<Key>> _keys;	// subscribed keys, one wait slot each
+			bool					_changed{ false };
+			bool					_running{ false };
+			bool					_stopping{ false };
+			Id						_lastId{ 0 };
+			HANDLE					_wakeEvent{ NULL };
+			std::thread				_thread;
+
+			void watchLoop();
+			void post(const std::shared_ptr<Subscription>& subscription);
+			// static, a queued callback can outlive the service
+			static void dispatch(const std::shared_ptr<Subscription>& subscription, const std::chrono::steady_clock::time_point notified);
+			static void dispatchImmediate(const std::shared_ptr<Subscription>& subscription);
+			static void fail(Key& key) noexcept;
+			// marks subscription inactive and waits for its running callback
+			static void retire(const std::shared_ptr<Subscription>& subscription) noexcept;
+		}; // class WatcherService
+
+		// subscription handle on WatcherService for a set of subkeys, below prefix when not empty
+		class RegistryWatcher : public Watcher
+		{
+		public:
+			RegistryWatcher(const HKEY root = HKEY_CURRENT_USER, const std::string& prefix = "") : _root(root), _prefix(prefix) {};
+			~RegistryWatcher();
+			RegistryWatcher(const RegistryWatcher&) = delete;
+			RegistryWatcher& operator=(const RegistryWatcher&) = delete;
+			const bool isWatching() const noexcept override;
+			void start(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback) override;
+			void stop() noexcept override;
+			const bool isPaused() const noexcept override;
+			void pause() noexcept override;
+			void resume() noexcept override;
+			void setCoalescing(const Coalescing& coalescing) noexcept override;
+			void setImmediate(const bool immediate) noexcept override;
+		private:
+			const HKEY			_root;
+			const std::string	_prefix;
+			Coalescing			_coalescing;
+			bool				_immediate{ false };
+			std::vector<WatcherService::Id> _subscriptions;
 			std::atomic<bool>   _paused{ false };
 
-			void setWatching(const bool watching) noexcept;
 			void setPaused(const bool paused) noexcept;
-			void watchLoop(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback);
-			const int watch(std::vector<HANDLE>& events, std::vector<HKEY>& keys);
-		}; // class Watcher
+		}; // class RegistryWatcher
+#endif // _WIN32
+
+		// stops the watcher and callback threads, queued callbacks are dropped and watching no longer works
+		// hosts unloading the library call it first, the threads are otherwise joined by static destructors
+		void shutdown() noexcept;
 
 		struct Header
 		{
@@ -55,6 +129,99 @@ namespace NightLightLibrary
 			int16_t     version{ ::bond::v1 };
 		}; // struct Metadata
 
+		// process-wide decoded records shared by every record of the same store and subkey
+		// an entry lives while records hold a lease on it and is invalidated by a single watcher of its store
+		class RecordCache
+		{
+		public:
+			// decoded record as load() leaves it, data points to the record's T::Data
+			struct Value
+			{
+				Header		header;
+				Metadata	metadata;
+				uint64_t	hash{ 0 };
+				std::shared_ptr<const void> data;
+			}; // struct Value
+
+			class Entry
+			{
+			public:
+				Entry() = default;
+				Entry(const Entry&) = delete;
+				Entry& operator=(const Entry&) = delete;
+				// bumped by every change notification
+				const uint64_t getVersion() const noexcept;
+				const bool isFresh() const noexcept;
+				// true when fresh with data hashing to hash
+				const bool holds(const uint64_t hash) const noexcept;
+				// false when stale
+				const bool get(Value& value) const;
+				// value read while the entry was at version, dropped if notified since
+				void put(const uint64_t version, Value&& value);
+				void invalidate() noexcept;
+			private:
+				friend class RecordCache;
+				mutable std::mutex	_mutex;
+				uint64_t			_version{ 0 };	// guarded by _mutex
+				bool				_fresh{ false };	// guarded by _mutex
+				Value				_value;			// guarded by _mutex
+				std::unique_ptr<Watcher> _watcher;	// destroyed first, its callback reaches this
+			}; // class Entry
+
+			static RecordCache& instance();
+			RecordCache(const RecordCache&) = delete;
+			RecordCache& operator=(const RecordCache&) = delete;
+
+			// entry of subKey in store, created and watched by the first lease
+			// nullptr when the store or the key cannot be watched
+			std::shared_ptr<Entry> acquire(const std::shared_ptr<Store>& store, const LPCSTR subKey, const LPCSTR valueName);
+			// entry of subKey in store while another lease keeps it, nullptr otherwise
+			std::shared_ptr<Entry> find(const std::shared_ptr<Store>& store, const LPCSTR subKey);
+			const size_t getEntryCount();
+		private:
+			RecordCache() = default;
+
+			// a lease holds the store, so an address is not reused while its entry lives
+			typedef std::pair<const Store*, std::string> Key;
+			std::mutex _mutex;
+			std::map<Key, std::weak_ptr<Entry>> _entries;
+		}; // class RecordCache
+
+		// bond output stream writing into one contiguous block
+		// reset() keeps the capacity so repeated saves of the same record do not allocate
+		class OutputArena
+		{
+		public:
+			void reset() noexcept { _size = 0; }
+			const uint8_t* data() const noexcept { return _data.data(); }
+			const size_t size() const noexcept { return _size; }
+			// number of times the arena had to allocate, stays flat once sized to the record
+			const uint64_t getGrowCount() const noexcept { return _grows; }
+
+			void Write(const void* buffer, uint32_t size)
+			{
+				if (_size + size > _data.size()) {
+					_data.resize(std::max<size_t>(_size + size, _data.size() * 2));
+					_grows++;
+				}
+				memcpy(&_data[_size], buffer, size);
+				_size += size;
+			}
+			void Write(const ::bond::blob& buffer)
+			{
+				Write(buffer.content(), buffer.size());
+			}
+			template<typename V> void Write(const V& value)
+			{
+				static_assert(std::is_trivially_copyable<V>::value, "must be trivially copyable");
+				Write(&value, sizeof(value));
+			}
+		private:
+			std::vector<uint8_t>	_data;
+			size_t					_size{ 0 };
+			uint64_t				_grows{ 0 };
+		}; // class OutputArena
+
 		template<typename T> struct Bond
 		{
 			// needs to be implemented for re-using objects with bond
@@ -70,6 +237,24 @@ namespace NightLightLibrary
 			constexpr LPCSTR Value = "Data";
 		} // namespace Name
 
+		// schema specific Compact Binary codec, specialized next to the record types
+		// read() and write() return false to let bond handle the data instead
+		template<typename T> struct Codec
+		{
+			static const bool read(CompactBinary::Reader&, T&) noexcept { return false; }
+			static const bool write(const T&, CompactBinary::Writer&) noexcept { return false; }
+		}; // struct Codec
+
+		enum class LoadResult
+		{
+			Failed,
+			Unchanged,	// stored bond data matches the last load or save, nothing was decoded
+			Loaded
+		}; // enum class LoadResult
+
+		template<typename T> const LoadResult load(T& obj);
+		template<typename T> const bool save(T& obj);
+
 		template<typename T> struct Record
 		{
 			constexpr static const LPCSTR	getRegistryValueName() noexcept { return Registry::Name::Value; };
@@ -77,29 +262,72 @@ namespace NightLightLibrary
 			Header			_header;
 			Metadata		_metadata;
 			bool            _dirty{ false };
+			std::shared_ptr<Store> _store{ getDefaultStore() };
+			// hash of the bond data (header excluded) last loaded or saved, valid when _hashed
+			uint64_t        _hash{ 0 };
+			bool            _hashed{ false };
 
 			static const bool load(T& obj) {
-				if (!Registry::load(obj))
-					return false;
-				obj._dirty = false;
-				return true;
+				return refresh(obj) != LoadResult::Failed;
+			}
+			// like load() but tells whether the stored data changed since the last load or save
+			static const LoadResult refresh(T& obj) {
+				const LoadResult result = Registry::load(obj);
+				if (result != LoadResult::Failed)
+					obj._dirty = false;
+				return result;
 			}
 			static const bool save(T& obj) { 
 				if (obj._dirty)
-					obj._dirty = Registry::save(obj);
+					obj._dirty = !Registry::save(obj);
 				return !obj._dirty;
 			}
 			virtual T& save() = 0;
 
-			void startWatching(const std::function<void()>& callback = []() noexcept {})
+			// saves skipped because the data matched what was last loaded or saved
+			static const uint64_t getSkippedSaveCount() noexcept { return _skippedSaves(); }
+			static std::atomic<uint64_t>& _skippedSaves() noexcept
 			{
-				if (_watcher)
-					_watcher->stop();
-				else
-					_watcher = std::make_unique<Watcher>();
+				static std::atomic<uint64_t> count{ 0 };
+				return count;
+			}
+			static Metrics::RecordMetrics& _metrics()
+			{
+				static Metrics::RecordMetrics& metrics = Metrics::record(T::getRegistryKey());
+				return metrics;
+			}
+
+			T& setStore(const std::shared_ptr<Store>& store)
+			{
+				_store = store ? store : getDefaultStore();
+				_cache.reset();
+				_cacheLooked = false;
+				return static_cast<T&>(*this);
+			}
+
+			// lease on the shared entry of the store and subkey, taken by the first load()
+			// a store without one is asked only once, until setStore()
+			static const std::shared_ptr<RecordCache::Entry>& _cacheEntry(T& obj)
+			{
+				if (!obj._cacheLooked) {
+					obj._cache = obj._shareCache
+						? RecordCache::instance().acquire(obj._store, T::getRegistryKey(), T::getRegistryValueName())
+						: RecordCache::instance().find(obj._store, T::getRegistryKey());
+					obj._cacheLooked = true;
+				}
+				return obj._cache;
+			}
+
+			void startWatching(const std::function<void()>& callback = []() noexcept {}, const Coalescing& coalescing = {})
+			{
+				_watcher = _store->createWatcher(T::getRegistryValueName());
+				if (!_watcher)
+					return; // the store cannot be watched
+				_watcher->setCoalescing(coalescing);
 
 				const std::vector<LPCSTR> subKeys{ T::getRegistryKey() };
 				const std::function<void(LPCSTR)> wrapper = [&, callback](LPCSTR) {
+					_notified = true;
 					callback();
 				};
 				_watcher->start(subKeys, wrapper);
@@ -109,6 +337,18 @@ namespace NightLightLibrary
 			void pauseWatching() noexcept	{ if (_watcher) _watcher->pause(); }
 			void resumeWatching() noexcept	{ if (_watcher) _watcher->resume(); }
 
+			// raw bytes of the last load(), kept to reuse its capacity
+			std::vector<uint8_t> _readBuffer;
+			// marshalled bytes of the last save(), kept to reuse its capacity
+			OutputArena          _writeBuffer;
+			std::shared_ptr<RecordCache::Entry> _cache;
+			// _cache was looked up, nullptr then means the store cannot share this record
+			bool                 _cacheLooked{ false };
+			// false only looks shared entries up, short-lived records then neither create one nor its watcher
+			bool                 _shareCache{ true };
+			// set by the record's watcher, the next load() reads the store as the shared entry may not be invalidated yet
+			std::atomic<bool>    _notified{ false };
+
 		protected:
 			~Record() {};
 		private:
@@ -127,24 +367,6 @@ namespace NightLightLibrary
 		}
 #endif
 
-		inline const DWORD getValueSize(const LPCSTR& regSubkey, const LPCSTR& regValueName) noexcept
-		{
-			DWORD dataSize = 0;
-			DWORD type = REG_BINARY;
-			const LSTATUS s = ::RegGetValueA(
-				HKEY_CURRENT_USER,
-				regSubkey,
-				regValueName,
-				RRF_RT_REG_BINARY,
-				&type,
-				nullptr,
-				&dataSize
-			);
-			if (s == ERROR_SUCCESS)
-				return dataSize;
-			return 0;
-		} // getValueSize()
-
 		template<typename T> inline void unmarshal(const ::bond::InputBuffer& buffer, T& obj)
 		{
 			// Unmarshal reads protocol version information from input stream and uses
@@ -152,40 +374,89 @@ namespace NightLightLibrary
 			bond::Unmarshal(buffer, obj);
 		} // unmarshal()
 
-		template<typename T> const bool load(T& obj)
+		// copy of what load() decoded into obj, for the other records of its store and subkey
+		template<typename T> RecordCache::Value share(const T& obj)
+		{
+			RecordCache::Value value;
+			value.header = obj._header;
+			value.metadata = obj._metadata;
+			value.hash = obj._hash;
+			value.data = std::make_shared<const typename T::Data>(static_cast<const typename T::Data&>(obj));
+			return value;
+		} // share()
+
+		template<typename T> const LoadResult load(T& obj)
 		{
 			static_assert(std::is_base_of<Record<T>, T>::value, "must be a Registry::Record");
-			DWORD dataSize = getValueSize(T::getRegistryKey(), T::getRegistryValueName());
+			Metrics::RecordMetrics& metrics = Record<T>::_metrics();
+			metrics.loads++;
 
-			if (dataSize == 0 || dataSize < sizeof(obj._header) + sizeof(obj._metadata))
-				return false;
+			// a fresh shared copy saves the read and the decode
+			const std::shared_ptr<RecordCache::Entry>& entry = Record<T>::_cacheEntry(obj);
+			const bool notified = obj._notified.exchange(false);
+			const uint64_t version = entry ? entry->getVersion() : 0;
+			RecordCache::Value cached;
+			if (entry && !notified && entry->get(cached)) {
+				metrics.cachedLoads++;
+				memcpy(&(obj._header), &(cached.header), sizeof(obj._header));
+				if (obj._hashed && !obj._dirty && cached.hash == obj._hash) {
+					metrics.unchangedLoads++;
+					return LoadResult::Unchanged;
+				}
+				static_cast<typename T::Data&>(obj) = *std::static_pointer_cast<const typename T::Data>(cached.data);
+				obj._metadata = cached.metadata;
+				obj._hash = cached.hash;
+				obj._hashed = true;
+				return LoadResult::Loaded;
+			}
 
-			std::vector<uint8_t> data(dataSize);
-
-			DWORD types = REG_BINARY;
-			const LSTATUS s = ::RegGetValueA(
-				HKEY_CURRENT_USER,
-				T::getRegistryKey(),
-				T::getRegistryValueName(),
-				RRF_RT_REG_BINARY,
-				&types,
-				data.data(),
-				&dataSize
-			);
-			if (s != ERROR_SUCCESS)
-				return false;
+			std::vector<uint8_t>& data = obj._readBuffer;
+			bool read;
+			{
+				Metrics::ScopedTimer timer(metrics.read);
+				read = obj._store->read(T::getRegistryKey(), T::getRegistryValueName(), data);
+			}
+			if (!read) {
+				metrics.readFailures++;
+				return LoadResult::Failed;
+			}
+			if (Corpus::isCapturing())
+				Corpus::capture(T::getRegistryKey(), data.data(), data.size());
+
+			const uint32_t dataSize = static_cast<uint32_t>(data.size());
+			if (dataSize < sizeof(obj._header) + sizeof(obj._metadata)) {
+				metrics.decodeFailures++;
+				return LoadResult::Failed;
+			}
 #ifdef _DEBUG
 			printData((uint8_t*)(data.data()), dataSize);
 #endif
+			// the header timestamp changes on every write, only the bond data tells if the record changed
+			const uint64_t hash = hashData(&data[sizeof(obj._header)], dataSize - sizeof(obj._header));
+			if (obj._hashed && !obj._dirty && hash == obj._hash) {
+				memcpy(&(obj._header), &data[0], sizeof(obj._header));
+				metrics.unchangedLoads++;
+				if (entry && !entry->isFresh())
+					entry->put(version, share(obj));
+				return LoadResult::Unchanged;
+			}
+			obj._hashed = false;
 			try
 			{
+				Metrics::ScopedTimer timer(metrics.decode);
 				::bond::InputBuffer input = ::bond::InputBuffer(&data[0], dataSize);
 				// copy header for saving back to registry
 				input.Read(&(obj._header), sizeof(obj._header));
 				
 				// copy metadata "manually" because InputBuffer cannot rewind in c++
 				memcpy(&(obj._metadata), &data[sizeof(obj._header)], sizeof(obj._metadata));
-				unmarshal(input, obj._reset());
+
+				constexpr size_t offset = sizeof(obj._header) + sizeof(obj._metadata);
+				CompactBinary::Reader reader(&data[offset], dataSize - offset, obj._metadata.version);
+				if (obj._metadata.protocol != ::bond::ProtocolType::COMPACT_PROTOCOL || !Codec<T>::read(reader, obj._reset())) {
+					metrics.bondDecodes++;
+					unmarshal(input, obj._reset());
+				}
 			}
 			catch (const std::exception& e)
 			{
@@ -194,16 +465,25 @@ namespace NightLightLibrary
 #else // _DEBUG
 				UNREFERENCED_PARAMETER(e);
 #endif // _DEBUG
-				return false;
+				metrics.decodeFailures++;
+				return LoadResult::Failed;
 			}
-			return true;
+			obj._hash = hash;
+			obj._hashed = true;
+			if (entry)
+				entry->put(version, share(obj));
+			return LoadResult::Loaded;
 		} // load()
 
-		template <typename T> const bool save(T& obj)
+		// writes the header and bond data of obj into obj._writeBuffer
+		template <typename T> const bool marshal(T& obj)
 		{
 			static_assert(std::is_base_of<Record<T>, T>::value, "must be a Registry::Record");
 
-			::bond::OutputBuffer output;
+			Metrics::RecordMetrics& metrics = Record<T>::_metrics();
+			Metrics::ScopedTimer timer(metrics.encode);
+			OutputArena& output = obj._writeBuffer;
+			output.reset();
 
 			// restore the original header with updated time
 			GetSystemTimeAsFileTime(&(obj._header.filetime));
@@ -217,7 +497,17 @@ namespace NightLightLibrary
 #ifdef BOND_COMPACT_BINARY_PROTOCOL
 				case ::bond::ProtocolType::COMPACT_PROTOCOL:
 				{
-					::bond::CompactBinaryWriter<::bond::OutputBuffer> writer(output, obj._metadata.version);
+					CompactBinary::Writer body(obj._metadata.version);
+					if (Codec<T>::write(obj, body) && body.good()) {
+						CompactBinary::Writer payload(obj._metadata.version);
+						payload.writeStruct(body);
+						output.Write(CompactBinary::Magic);
+						output.Write(static_cast<uint16_t>(obj._metadata.version));
+						output.Write(payload.data(), static_cast<uint32_t>(payload.size()));
+						break;
+					}
+					metrics.bondEncodes++;
+					::bond::CompactBinaryWriter<OutputArena> writer(output, obj._metadata.version);
 					::bond::Marshal(obj, writer);
 				}
 				break;
@@ -225,7 +515,8 @@ namespace NightLightLibrary
 #ifdef BOND_FAST_BINARY_PROTOCOL
 				case ::bond::ProtocolType::FAST_PROTOCOL:
 				{
-					::bond::FastBinaryWriter<::bond::OutputBuffer> writer(output);
+					metrics.bondEncodes++;
+					::bond::FastBinaryWriter<OutputArena> writer(output);
 					::bond::Marshal(obj, writer);
 				}
 				break;
@@ -233,12 +524,14 @@ namespace NightLightLibrary
 #ifdef BOND_SIMPLE_BINARY_PROTOCOL
 				case ::bond::ProtocolType::SIMPLE_PROTOCOL:
 				{
-					::bond::SimpleBinaryWriter<::bond::OutputBuffer> writer(output, obj._metadata.version);
+					metrics.bondEncodes++;
+					::bond::SimpleBinaryWriter<OutputArena> writer(output, obj._metadata.version);
 					::bond::Marshal(obj, writer);
 				}
 				break;
 #endif
 				default:
+					metrics.encodeFailures++;
 					return false;
 				}
 			}
@@ -249,23 +542,91 @@ namespace NightLightLibrary
 #else // _DEBUG
 				UNREFERENCED_PARAMETER(e);
 #endif // _DEBUG
+				metrics.encodeFailures++;
+				return false;
+			}
+			return true;
+		} // marshal()
+
+		template<typename T> inline const uint64_t hashWriteBuffer(const T& obj) noexcept
+		{
+			const OutputArena& output = obj._writeBuffer;
+			return hashData(output.data() + sizeof(obj._header), output.size() - sizeof(obj._header));
+		} // hashWriteBuffer()
+
+		// true when the store is known to hold bond data hashing to hash
+		// obj._hash alone cannot tell, another record or process may have written since obj loaded or saved
+		// a fresh cache entry tells without reading, otherwise the value is read back if obj._hash matches
+		template <typename T> const bool isHeld(T& obj, const uint64_t hash)
+		{
+			const std::shared_ptr<RecordCache::Entry>& entry = Record<T>::_cacheEntry(obj);
+			if (entry && entry->isFresh())
+				return entry->holds(hash);
+			if (!obj._hashed || hash != obj._hash)
+				return false;
+			Metrics::RecordMetrics& metrics = Record<T>::_metrics();
+			std::vector<uint8_t>& data = obj._readBuffer;
+			bool read;
+			{
+				Metrics::ScopedTimer timer(metrics.read);
+				read = obj._store->read(T::getRegistryKey(), T::getRegistryValueName(), data);
+			}
+			return read && data.size() >= sizeof(obj._header) &&
+				hashData(data.data() + sizeof(obj._header), data.size() - sizeof(obj._header)) == hash;
+		} // isHeld()
+
+		// true when obj would marshal to the bond data the store holds
+		template <typename T> const bool isStored(T& obj)
+		{
+			return marshal(obj) && isHeld(obj, hashWriteBuffer(obj));
+		} // isStored()
+
+		template <typename T> const bool save(T& obj)
+		{
+			if (!marshal(obj))
 				return false;
+
+			// an identical write would still wake every watcher of the key, the OS included
+			const uint64_t hash = hashWriteBuffer(obj);
+			if (isHeld(obj, hash)) {
+				obj._hash = hash;
+				obj._hashed = true;
+				Record<T>::_skippedSaves()++;
+				return true;
+			}
+
+			Metrics::RecordMetrics& metrics = Record<T>::_metrics();
+			metrics.saves++;
+			const std::shared_ptr<RecordCache::Entry>& entry = Record<T>::_cacheEntry(obj);
+			const uint64_t version = entry ? entry->getVersion() : 0;
+			const OutputArena& output = obj._writeBuffer;
+			bool written;
+			{
+				Metrics::ScopedTimer timer(metrics.write);
+				written = obj._store->write(
+					T::getRegistryKey(),
+					T::getRegistryValueName(),
+					output.data(),
+					output.size()
+				);
+			}
+			if (!written)
+				metrics.writeFailures++;
+			obj._hash = hash;
+			obj._hashed = written;
+			if (entry) {
+				// other records load what was just written, without waiting for the watcher
+				if (written)
+					entry->put(version, share(obj));
+				else
+					entry->invalidate();
 			}
-			
-			const LSTATUS s = ::RegSetKeyValueA(
-				HKEY_CURRENT_USER,
-				T::getRegistryKey(),
-				T::getRegistryValueName(),
-				REG_BINARY,
-				output.GetBuffer().data(),
-				output.GetBuffer().size()
-			);
 
 #ifdef _DEBUG
-			printData((uint8_t*)(output.GetBuffer().data()), output.GetBuffer().size());
+			printData(output.data(), static_cast<uint32_t>(output.size()));
 #endif // _DEBUG
 
-			return (s == ERROR_SUCCESS);
+			return written;
 		} // save()
 	} // namespace Registry
 }; // namespace NightLightLibrary
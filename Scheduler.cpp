@@ -0,0 +1,174 @@
+#include "stdafx.h"
+#include "Scheduler.h"
+#include <algorithm>
+#include <iostream>
+
+namespace NightLightLibrary
+{
+#ifdef _WIN32
+	constexpr ULONGLONG FileTimeMillisecond = 10'000; // 100 ns units
+	constexpr ULONGLONG FileTimeDay = 24ULL * 60 * 60 * 1'000 * FileTimeMillisecond;
+	constexpr uint16_t MinutesPerDay = 24 * 60;
+
+	static ULONGLONG fromFileTime(const FILETIME& filetime) noexcept
+	{
+		ULARGE_INTEGER value;
+		value.LowPart = filetime.dwLowDateTime;
+		value.HighPart = filetime.dwHighDateTime;
+		return value.QuadPart;
+	}
+
+	static FILETIME toFileTime(const ULONGLONG value) noexcept
+	{
+		ULARGE_INTEGER v;
+		v.QuadPart = value;
+		return { v.LowPart, v.HighPart };
+	}
+
+	Scheduler::Scheduler(const std::function<void(const ScheduleEvent)>& callback, const ULONGLONG transition)
+		: _callback(callback), _transition(transition * FileTimeMillisecond)
+	{
+		_timer = ::CreateWaitableTimerA(NULL, FALSE, NULL); // auto reset
+		_wakeEvent = ::CreateEventA(NULL, FALSE, FALSE, NULL); // auto reset
+		if (_timer != NULL && _wakeEvent != NULL)
+			_thread = std::thread(&Scheduler::run, this);
+	}
+
+	Scheduler::~Scheduler()
+	{
+		{
+			std::lock_guard<CriticalSection> lock(_mutex);
+			_stopping = true;
+		}
+		if (_wakeEvent != NULL)
+			::SetEvent(_wakeEvent);
+		if (_thread.joinable())
+			_thread.join();
+		if (_timer != NULL)
+			::CloseHandle(_timer);
+		if (_wakeEvent != NULL)
+			::CloseHandle(_wakeEvent);
+	}
+
+	void Scheduler::reschedule(const bool enabled, const uint16_t start, const uint16_t end) noexcept
+	{
+		{
+			std::lock_guard<CriticalSection> lock(_mutex);
+			if (enabled == _enabled && start == _start && end == _end)
+				return;
+			_enabled = enabled;
+			_start = start;
+			_end = end;
+			_generation++;
+		}
+		if (_wakeEvent != NULL)
+			::SetEvent(_wakeEvent);
+	}
+
+	const bool Scheduler::getNext(ScheduleEvent& event, ULONGLONG& dueTime) const
+	{
+		std::lock_guard<CriticalSection> lock(_mutex);
+		return next(event, dueTime);
+	}
+
+	const ULONGLONG Scheduler::nextOccurrence(const uint16_t minuteOfDay, const ULONGLONG after) noexcept
+	{
+		const FILETIME afterFileTime = toFileTime(after);
+		SYSTEMTIME utc, local;
+		if (!::FileTimeToSystemTime(&afterFileTime, &utc) || !::SystemTimeToTzSpecificLocalTime(NULL, &utc, &local))
+			return 0;
+		local.wHour = static_cast<WORD>(minuteOfDay / 60);
+		local.wMinute = static_cast<WORD>(minuteOfDay % 60);
+		local.wSecond = 0;
+		local.wMilliseconds = 0;
+		FILETIME today;
+		if (!::SystemTimeToFileTime(&local, &today))
+			return 0;
+		// walks local days so the instant follows daylight saving changes, yesterday covers time zones ahead of UTC
+		for (ULONGLONG day = fromFileTime(today) - FileTimeDay; day <= fromFileTime(today) + 2 * FileTimeDay; day += FileTimeDay) {
+			const FILETIME candidate = toFileTime(day);
+			SYSTEMTIME candidateLocal, candidateUtc;
+			FILETIME due;
+			if (!::FileTimeToSystemTime(&candidate, &candidateLocal) ||
+				!::TzSpecificLocalTimeToSystemTime(NULL, &candidateLocal, &candidateUtc) ||
+				!::SystemTimeToFileTime(&candidateUtc, &due))
+				return 0;
+			if (fromFileTime(due) > after)
+				return fromFileTime(due);
+		}
+		return 0;
+	}
+
+	const bool Scheduler::next(ScheduleEvent& event, ULONGLONG& dueTime) const noexcept
+	{
+		FILETIME now;
+		::GetSystemTimeAsFileTime(&now);
+		// never reports an event twice, even when the timer fired a little before the clock reached it
+		const ULONGLONG after = std::max(fromFileTime(now), _lastDue);
+
+		dueTime = 0;
+		if (_transitionEnd > after) {
+			event = ScheduleEvent::TransitionEnd;
+			dueTime = _transitionEnd;
+		}
+		if (_enabled && _start != _end) {
+			const ULONGLONG start = nextOccurrence(_start, after);
+			const ULONGLONG end = (_end + 1) % MinutesPerDay != _start ? nextOccurrence(_end, after) : 0;
+			if (start != 0 && (dueTime == 0 || start < dueTime)) {
+				event = ScheduleEvent::Start;
+				dueTime = start;
+			}
+			if (end != 0 && (dueTime == 0 || end < dueTime)) {
+				event = ScheduleEvent::End;
+				dueTime = end;
+			}
+		}
+		return dueTime != 0;
+	}
+
+	void Scheduler::run()
+	{
+		const HANDLE handles[] = { _wakeEvent, _timer };
+		for (;;) {
+			ScheduleEvent event;
+			ULONGLONG dueTime;
+			bool armed;
+			uint64_t generation;
+			{
+				std::lock_guard<CriticalSection> lock(_mutex);
+				if (_stopping)
+					return;
+				armed = next(event, dueTime);
+				generation = _generation;
+			}
+			if (armed) {
+				LARGE_INTEGER due;
+				due.QuadPart = static_cast<LONGLONG>(dueTime); // positive: absolute UTC
+				::SetWaitableTimer(_timer, &due, 0, NULL, NULL, FALSE);
+			}
+			else
+				::CancelWaitableTimer(_timer);
+
+			// the wake event comes first so a reschedule wins over a timer that fired at the same time
+			const DWORD result = ::WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+			if (result == WAIT_FAILED)
+				return;
+			if (result != WAIT_OBJECT_0 + 1)
+				continue;
+			{
+				std::lock_guard<CriticalSection> lock(_mutex);
+				if (_stopping)
+					return;
+				if (generation != _generation)
+					continue; // due time computed for the previous schedule
+				_lastDue = dueTime;
+				_transitionEnd = (event == ScheduleEvent::TransitionEnd) ? 0 : dueTime + _transition;
+			}
+#ifdef _DEBUG
+			std::cout << "[Scheduler] event " << static_cast<int>(event) << std::endl;
+#endif // _DEBUG
+			_callback(event);
+		}
+	}
+#endif // _WIN32
+} // namespace NightLightLibrary
\ No newline at end of file
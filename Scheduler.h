@@ -0,0 +1,55 @@
+#pragma once
+#include "Platform.h"
+#include <functional>
+#include <thread>
+#include "NightLightWrapper.h"
+#include "CriticalSection.h"
+
+namespace NightLightLibrary
+{
+#ifdef _WIN32
+	// waits for the next schedule switch, or the end of the transition it started, on one waitable timer
+	// due times are absolute UTC, so sleeping or moving the clock does not delay a switch
+	class Scheduler
+	{
+	public:
+		// transition: ms from a switch to the end of the transition it starts
+		Scheduler(const std::function<void(const ScheduleEvent)>& callback, const ULONGLONG transition);
+		// callbacks must not destroy their scheduler
+		~Scheduler();
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator=(const Scheduler&) = delete;
+
+		// start and end are minutes of the local day, a disabled schedule only finishes the running transition
+		// a schedule starting when it ends is empty and treated as disabled, its Start and End would fire together
+		// one ending the minute before it starts covers the whole day and fires no End
+		// the timer is rearmed only when the schedule changed, called when NightLight publishes so it cannot throw
+		void reschedule(const bool enabled, const uint16_t start, const uint16_t end) noexcept;
+		// false when nothing is due
+		const bool getNext(ScheduleEvent& event, ULONGLONG& dueTime) const;
+
+		// first UTC FILETIME strictly after "after" at which the local clock reads minuteOfDay, 0 on failure
+		static const ULONGLONG nextOccurrence(const uint16_t minuteOfDay, const ULONGLONG after) noexcept;
+	private:
+		const std::function<void(const ScheduleEvent)> _callback;
+		const ULONGLONG			_transition; // in FILETIME units
+
+		mutable CriticalSection	_mutex;
+		bool					_enabled{ false };
+		uint16_t				_start{ 0 };
+		uint16_t				_end{ 0 };
+		ULONGLONG				_lastDue{ 0 };			// due time of the last event fired
+		ULONGLONG				_transitionEnd{ 0 };	// 0 when no transition is running
+		uint64_t				_generation{ 0 };		// bumped by reschedule()
+		bool					_stopping{ false };
+
+		HANDLE					_timer{ NULL };
+		HANDLE					_wakeEvent{ NULL };
+		std::thread				_thread;
+
+		// caller holds _mutex
+		const bool next(ScheduleEvent& event, ULONGLONG& dueTime) const noexcept;
+		void run();
+	}; // class Scheduler
+#endif // _WIN32
+} // namespace NightLightLibrary
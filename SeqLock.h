@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace NightLightLibrary
+{
+	// versioned value published by one writer at a time and read without locks
+	// readers copy the value and retry only when a store() overlapped the copy
+	template<typename T>
+	class SeqLock
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied word by word");
+		static constexpr size_t Words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	public:
+		SeqLock() noexcept
+		{
+			for (auto& word : _words)
+				word.store(0, std::memory_order_relaxed);
+		}
+
+		// callers serialize stores, the sequence is odd while one is in progress
+		void store(const T& value) noexcept
+		{
+			uint64_t words[Words] = {};
+			std::memcpy(words, &value, sizeof(T));
+			const uint64_t sequence = _sequence.load(std::memory_order_relaxed);
+			_sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			for (size_t i = 0; i < Words; i++)
+				_words[i].store(words[i], std::memory_order_relaxed);
+			_sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		T load() const noexcept
+		{
+			uint64_t words[Words];
+			uint64_t before, after;
+			do {
+				before = _sequence.load(std::memory_order_acquire);
+				for (size_t i = 0; i < Words; i++)
+					words[i] = _words[i].load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				after = _sequence.load(std::memory_order_relaxed);
+			} while (before != after || (before & 1) != 0);
+			T value;
+			std::memcpy(&value, words, sizeof(T));
+			return value;
+		}
+
+		// number of completed stores
+		const uint64_t getVersion() const noexcept
+		{
+			return _sequence.load(std::memory_order_acquire) / 2;
+		}
+	private:
+		std::atomic<uint64_t>	_sequence{ 0 };
+		std::atomic<uint64_t>	_words[Words];
+	}; // class SeqLock
+} // namespace NightLightLibrary
@@ -6,10 +6,6 @@ namespace NightLightLibrary
 
 #pragma region Settings
 
-	const LPCSTR Settings::getRegistryKey() {
-		static const std::string key = Schema::metadata.attributes.find(Registry::Name::SubkeyAttribute)->second;
-		return key.c_str();
-	}
 	Time Settings::getStartTime() const noexcept
 	{
 		return (isOnSunSchedule() ? sunScheduleStartTime : manualScheduleStartTime);
@@ -34,6 +30,14 @@ namespace NightLightLibrary
 		return *this;
 	}
 
+	Settings& Settings::setSunSchedule(const Time& start, const Time& end)
+	{
+		sunScheduleStartTime = start;
+		sunScheduleEndTime = end;
+		_dirty = true;
+		return *this;
+	}
+
 	const bool Settings::isEnabled() const noexcept
 	{
 		return enabled;
@@ -65,14 +69,13 @@ namespace NightLightLibrary
 
 	const int16_t Settings::getDayColorTemperature() const noexcept
 	{
-		return static_cast<int16_t>(Schema::var::colorTemperature::metadata.default_value.int_value);
+		return Constants::_Settings::colorTemperature::Default;
 	}
 
 	Settings& Settings::setNightColorTemperature(const int16_t ctemp)
 	{
-		static const int16_t minTemp = ::boost::lexical_cast<int16_t>(Schema::var::colorTemperature::metadata.attributes.find("Min")->second);
-		static const int16_t maxTemp = ::boost::lexical_cast<int16_t>(Schema::var::colorTemperature::metadata.attributes.find("Max")->second);
-		colorTemperature = std::min(std::max(ctemp, minTemp), maxTemp);
+		namespace ct = Constants::_Settings::colorTemperature;
+		colorTemperature = std::min(std::max(ctemp, ct::Min), ct::Max);
 		_dirty = true;
 		return *this;
 	}
@@ -90,11 +93,11 @@ namespace NightLightLibrary
 	
 	Settings& Settings::_reset() noexcept
 	{
-		enabled = (Schema::var::enabled::metadata.default_value.uint_value == 1);
+		enabled = Constants::_Settings::enabled::Default;
 		
-		onSunSchedule = (Schema::var::onSunSchedule::metadata.default_value.uint_value == 1);
+		onSunSchedule = Constants::_Settings::onSunSchedule::Default;
 		
-		colorTemperature = static_cast<int16_t>(Schema::var::colorTemperature::metadata.default_value.int_value);
+		colorTemperature = Constants::_Settings::colorTemperature::Default;
 		
 		manualScheduleStartTime._reset();
 		manualScheduleEndTime._reset();
@@ -102,7 +105,7 @@ namespace NightLightLibrary
 		sunScheduleStartTime._reset();
 		sunScheduleEndTime._reset();
 
-		previewing = (Schema::var::previewing::metadata.default_value.uint_value == 1);
+		previewing = Constants::_Settings::previewing::Default;
 
 		_dirty = true;
 		return *this;
@@ -114,17 +117,15 @@ namespace NightLightLibrary
 
 	Time& Time::setHours(const int8_t h)
 	{
-		static const int8_t minH = static_cast<int8_t>(::boost::lexical_cast<int16_t>(Schema::var::hours::metadata.attributes.find("Min")->second));
-		static const int8_t maxH = static_cast<int8_t>(::boost::lexical_cast<int16_t>(Schema::var::hours::metadata.attributes.find("Max")->second));
-		hours = std::min(std::max(h, minH), maxH);
+		namespace hs = Constants::_Time::hours;
+		hours = std::min(std::max(h, hs::Min), hs::Max);
 		return *this;
 	}
 
 	Time& Time::setMinutes(const int8_t m)
 	{
-		static const int8_t minM = static_cast<int8_t>(::boost::lexical_cast<int16_t>(Schema::var::minutes::metadata.attributes.find("Min")->second));
-		static const int8_t maxM = static_cast<int8_t>(::boost::lexical_cast<int16_t>(Schema::var::minutes::metadata.attributes.find("Max")->second));
-		minutes = std::min(std::max(m, minM), maxM);
+		namespace ms = Constants::_Time::minutes;
+		minutes = std::min(std::max(m, ms::Min), ms::Max);
 		return *this;
 	}
 
@@ -142,8 +143,8 @@ namespace NightLightLibrary
 
 	Time& Time::_reset() noexcept
 	{
-		hours = static_cast<int8_t>(Schema::var::hours::metadata.default_value.int_value);
-		minutes = static_cast<int8_t>(Schema::var::minutes::metadata.default_value.int_value);
+		hours = Constants::_Time::hours::Default;
+		minutes = Constants::_Time::minutes::Default;
 		return *this;
 	}
 
@@ -160,7 +161,7 @@ namespace NightLightLibrary
 	{
 		if (start.hours > end.hours || (start.hours == end.hours && start.minutes > end.minutes))
 			end.hours += 24;
-		if (start.hours > t.hours || (start.hours == t.hours && start.minutes > t.hours))
+		if (start.hours > t.hours || (start.hours == t.hours && start.minutes > t.minutes))
 			t.hours += 24;
 		const uint16_t tm = t.toMinutes();
 		return (tm >= start.toMinutes() && tm <= end.toMinutes());
@@ -173,4 +174,120 @@ namespace NightLightLibrary
 
 #pragma endregion Time
 
+
+#pragma region Codec
+
+	namespace Registry
+	{
+		using namespace CompactBinary;
+
+		static const bool isSupportedVersion(const uint16_t version) noexcept
+		{
+			return version == ::bond::v1 || version == ::bond::v2;
+		}
+
+		static const bool readTime(Reader& reader, const uint8_t type, Time& obj) noexcept
+		{
+			return type == Type::Struct && Codec<Time>::read(reader, obj);
+		}
+
+		static void writeTime(Writer& writer, const uint16_t id, const Time& obj) noexcept
+		{
+			writer.writeFieldBegin(Type::Struct, id);
+			Writer body(writer.getVersion());
+			Codec<Time>::write(obj, body);
+			writer.writeStruct(body);
+		}
+
+		const bool Codec<Time>::read(Reader& reader, Time& obj) noexcept
+		{
+			namespace field = Constants::_Time;
+			const uint8_t* end;
+			if (!reader.readStructBegin(end))
+				return false;
+			for (;;) {
+				uint8_t type;
+				uint16_t id;
+				if (!reader.readFieldBegin(type, id))
+					return false;
+				if (type == Type::Stop)
+					break;
+				switch (id)
+				{
+				case field::hours::Id: if (!reader.readValue(type, obj.hours)) return false; break;
+				case field::minutes::Id: if (!reader.readValue(type, obj.minutes)) return false; break;
+				default: return false; // unknown field, leave it to bond
+				}
+			}
+			return reader.readStructEnd(end);
+		}
+
+		const bool Codec<Time>::write(const Time& obj, Writer& writer) noexcept
+		{
+			namespace field = Constants::_Time;
+			// optional fields equal to their default are omitted, like bond does
+			if (obj.hours != field::hours::Default)
+				writer.writeField(field::hours::Id, obj.hours);
+			if (obj.minutes != field::minutes::Default)
+				writer.writeField(field::minutes::Id, obj.minutes);
+			writer.writeStructEnd();
+			return writer.good();
+		}
+
+		const bool Codec<Settings>::read(Reader& reader, Settings& obj) noexcept
+		{
+			namespace field = Constants::_Settings;
+			if (!isSupportedVersion(reader.getVersion()))
+				return false;
+			const uint8_t* end;
+			if (!reader.readStructBegin(end))
+				return false;
+			bool hasColorTemperature = false; // required
+			for (;;) {
+				uint8_t type;
+				uint16_t id;
+				if (!reader.readFieldBegin(type, id))
+					return false;
+				if (type == Type::Stop)
+					break;
+				switch (id)
+				{
+				case field::enabled::Id: if (!reader.readValue(type, obj.enabled)) return false; break;
+				case field::onSunSchedule::Id: if (!reader.readValue(type, obj.onSunSchedule)) return false; break;
+				case field::manualScheduleStartTime::Id: if (!readTime(reader, type, obj.manualScheduleStartTime)) return false; break;
+				case field::manualScheduleEndTime::Id: if (!readTime(reader, type, obj.manualScheduleEndTime)) return false; break;
+				case field::colorTemperature::Id: if (!reader.readValue(type, obj.colorTemperature)) return false; hasColorTemperature = true; break;
+				case field::sunScheduleStartTime::Id: if (!readTime(reader, type, obj.sunScheduleStartTime)) return false; break;
+				case field::sunScheduleEndTime::Id: if (!readTime(reader, type, obj.sunScheduleEndTime)) return false; break;
+				case field::previewing::Id: if (!reader.readValue(type, obj.previewing)) return false; break;
+				default: return false; // unknown field, leave it to bond
+				}
+			}
+			return hasColorTemperature && reader.readStructEnd(end);
+		}
+
+		const bool Codec<Settings>::write(const Settings& obj, Writer& writer) noexcept
+		{
+			namespace field = Constants::_Settings;
+			if (!isSupportedVersion(writer.getVersion()))
+				return false;
+			// optional scalars equal to their default are omitted, like bond does
+			if (obj.enabled != field::enabled::Default)
+				writer.writeField(field::enabled::Id, obj.enabled);
+			if (obj.onSunSchedule != field::onSunSchedule::Default)
+				writer.writeField(field::onSunSchedule::Id, obj.onSunSchedule);
+			writeTime(writer, field::manualScheduleStartTime::Id, obj.manualScheduleStartTime);
+			writeTime(writer, field::manualScheduleEndTime::Id, obj.manualScheduleEndTime);
+			writer.writeField(field::colorTemperature::Id, obj.colorTemperature);
+			writeTime(writer, field::sunScheduleStartTime::Id, obj.sunScheduleStartTime);
+			writeTime(writer, field::sunScheduleEndTime::Id, obj.sunScheduleEndTime);
+			if (obj.previewing != field::previewing::Default)
+				writer.writeField(field::previewing::Id, obj.previewing);
+			writer.writeStructEnd();
+			return writer.good();
+		}
+	} // namespace Registry
+
+#pragma endregion Codec
+
 } // namespace NightLightLibrary
\ No newline at end of file
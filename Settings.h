@@ -1,5 +1,6 @@
 #pragma once
 #include "nightlight_schema_types.h"
+#include "nightlight_schema_constants.h"
 #include "Registry.h"
 
 namespace NightLightLibrary
@@ -23,12 +24,15 @@ namespace NightLightLibrary
 
 	struct Settings : public _Settings<Time>, public Registry::Record<Settings>, public Registry::Bond<Settings>
 	{
-		static const LPCSTR getRegistryKey();
+		typedef _Settings<Time> Data; // schema fields, what RecordCache shares
+		constexpr static const LPCSTR getRegistryKey() noexcept { return Constants::_Settings::RegistrySubkey; }
 
 		Time getStartTime() const noexcept;
 		Settings& setStartTime(const Time& time);
 		Time getEndTime() const noexcept;
 		Settings& setEndTime(const Time& time);
+		// sun schedule times are normally written by Windows
+		Settings& setSunSchedule(const Time& start, const Time& end);
 
 		const bool isEnabled() const noexcept;
 		Settings& setEnabled(const bool enabled) noexcept;
@@ -46,4 +50,19 @@ namespace NightLightLibrary
 
 		Settings& _reset() noexcept override;
 	}; // struct Settings
+
+	namespace Registry
+	{
+		template<> struct Codec<Time>
+		{
+			static const bool read(CompactBinary::Reader& reader, Time& obj) noexcept;
+			static const bool write(const Time& obj, CompactBinary::Writer& writer) noexcept;
+		}; // struct Codec<Time>
+
+		template<> struct Codec<Settings>
+		{
+			static const bool read(CompactBinary::Reader& reader, Settings& obj) noexcept;
+			static const bool write(const Settings& obj, CompactBinary::Writer& writer) noexcept;
+		}; // struct Codec<Settings>
+	} // namespace Registry
 }; // namespace NightLightLibrary
\ No newline at end of file
@@ -6,11 +6,6 @@ namespace NightLightLibrary
 
 #pragma region State
 
-	const LPCSTR State::getRegistryKey() { 
-		static const std::string key = Schema::metadata.attributes.find(Registry::Name::SubkeyAttribute)->second;
-		return key.c_str();
-	}
-
 	const bool State::wasManuallyTriggered() const noexcept
 	{
 		return trigger == TriggerType::Manual;
@@ -49,15 +44,13 @@ namespace NightLightLibrary
 
 	State& State::_reset()
 	{
-		if (Schema::var::status::metadata.default_value.nothing)
-			status.set_nothing();
-		else
-			status = static_cast<Status>(Schema::var::status::metadata.default_value.int_value);
+		static_assert(Constants::_State::status::DefaultIsNothing, "status is expected to default to nothing");
+		status.set_nothing();
 
-		trigger = static_cast<TriggerType>(Schema::var::trigger::metadata.default_value.int_value);
+		trigger = Constants::_State::trigger::Default;
 
-		changedOn = Schema::var::changedOn::metadata.default_value.uint_value;
-		usable = (Schema::var::usable::metadata.default_value.uint_value == 1);
+		changedOn = Constants::_State::changedOn::Default;
+		usable = Constants::_State::usable::Default;
 		_dirty = true;
 		return *this;
 	}
@@ -66,13 +59,88 @@ namespace NightLightLibrary
 	{
 		if (_dirty == false)
 			return *this;
-		GetSystemTimeAsFileTime((LPFILETIME)&changedOn);
 		//if (isRunning() || (starsAligned && isUsable()))
 		trigger = isUsable() ? TriggerType::Manual : TriggerType::Automatic;
+		// a fresh changedOn would defeat the identical write check, only stamp real changes
+		if (Registry::isStored(*this)) {
+			_skippedSaves()++;
+			_dirty = false;
+			return *this;
+		}
+		GetSystemTimeAsFileTime((LPFILETIME)&changedOn);
 		Record::save(*this);
 		return *this;
 	}
 
 #pragma endregion State
 
+
+#pragma region Codec
+
+	namespace Registry
+	{
+		using namespace CompactBinary;
+
+		const bool Codec<State>::read(Reader& reader, State& obj) noexcept
+		{
+			namespace field = Constants::_State;
+			if (reader.getVersion() != ::bond::v1 && reader.getVersion() != ::bond::v2)
+				return false;
+			const uint8_t* end;
+			if (!reader.readStructBegin(end))
+				return false;
+			for (;;) {
+				uint8_t type;
+				uint16_t id;
+				if (!reader.readFieldBegin(type, id))
+					return false;
+				if (type == Type::Stop)
+					break;
+				switch (id)
+				{
+				case field::status::Id:
+				{
+					int32_t status;
+					if (!reader.readValue(type, status))
+						return false;
+					obj.status = static_cast<Status>(status);
+				}
+				break;
+				case field::trigger::Id:
+				{
+					int32_t trigger;
+					if (!reader.readValue(type, trigger))
+						return false;
+					obj.trigger = static_cast<TriggerType>(trigger);
+				}
+				break;
+				case field::changedOn::Id: if (!reader.readValue(type, obj.changedOn)) return false; break;
+				case field::usable::Id: if (!reader.readValue(type, obj.usable)) return false; break;
+				default: return false; // unknown field, leave it to bond
+				}
+			}
+			return reader.readStructEnd(end);
+		}
+
+		const bool Codec<State>::write(const State& obj, Writer& writer) noexcept
+		{
+			namespace field = Constants::_State;
+			if (writer.getVersion() != ::bond::v1 && writer.getVersion() != ::bond::v2)
+				return false;
+			// optional fields equal to their default (or nothing) are omitted, like bond does
+			if (!obj.status.is_nothing())
+				writer.writeField(field::status::Id, static_cast<int32_t>(obj.status.value()));
+			if (obj.trigger != field::trigger::Default)
+				writer.writeField(field::trigger::Id, static_cast<int32_t>(obj.trigger));
+			if (obj.changedOn != field::changedOn::Default)
+				writer.writeField(field::changedOn::Id, obj.changedOn);
+			if (obj.usable != field::usable::Default)
+				writer.writeField(field::usable::Id, obj.usable);
+			writer.writeStructEnd();
+			return writer.good();
+		}
+	} // namespace Registry
+
+#pragma endregion Codec
+
 } // namespace NightLightLibrary
\ No newline at end of file
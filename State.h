@@ -1,12 +1,14 @@
 #pragma once
 #include "nightlight_schema_types.h"
+#include "nightlight_schema_constants.h"
 #include "Registry.h"
 
 namespace NightLightLibrary
 {
 	struct State : public _State, public Registry::Record<State>, public Registry::Bond<State>
 	{
-		static const LPCSTR getRegistryKey();
+		typedef _State Data; // schema fields, what RecordCache shares
+		constexpr static const LPCSTR getRegistryKey() noexcept { return Constants::_State::RegistrySubkey; }
 		
 		const bool wasManuallyTriggered() const noexcept;
 		
@@ -21,4 +23,13 @@ namespace NightLightLibrary
 
 		State& _reset() override;
 	}; // struct State
+
+	namespace Registry
+	{
+		template<> struct Codec<State>
+		{
+			static const bool read(CompactBinary::Reader& reader, State& obj) noexcept;
+			static const bool write(const State& obj, CompactBinary::Writer& writer) noexcept;
+		}; // struct Codec<State>
+	} // namespace Registry
 } // namespace NightLightLibrary
@@ -0,0 +1,256 @@
+#include "stdafx.h"
+#include "Store.h"
+#include "FileWatcher.h"
+#ifdef _WIN32
+#include "Registry.h"
+#endif // _WIN32
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <thread>
+#ifndef _WIN32
+#include <unistd.h>
+#endif // _WIN32
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		std::unique_ptr<Watcher> Store::createWatcher(const LPCSTR valueName) const
+		{
+			UNREFERENCED_PARAMETER(valueName);
+			return nullptr;
+		}
+
+
+#ifdef _WIN32
+#pragma region RegistryStore
+
+		// large enough for Settings and State blobs, so the first read is usually a single call
+		constexpr size_t InitialReadSize = 128;
+
+		std::shared_ptr<RegistryStore> RegistryStore::forProfile(const std::string& sid)
+		{
+			return std::make_shared<RegistryStore>(HKEY_USERS, sid);
+		}
+
+		const std::string RegistryStore::getSubKey(const LPCSTR subKey) const
+		{
+			return _prefix.empty() ? std::string(subKey) : _prefix + "\\" + subKey;
+		}
+
+		const bool RegistryStore::read(const LPCSTR subKey, const LPCSTR valueName, std::vector<uint8_t>& data)
+		{
+			_reads++;
+			const std::string prefixed = _prefix.empty() ? std::string() : getSubKey(subKey);
+			const LPCSTR key = _prefix.empty() ? subKey : prefixed.c_str();
+			if (data.capacity() < InitialReadSize)
+				data.reserve(InitialReadSize);
+			// read straight into the existing capacity, resize() does not reallocate here
+			data.resize(data.capacity());
+
+			DWORD dataSize = static_cast<DWORD>(data.size());
+			DWORD type = REG_BINARY;
+			LSTATUS s = ::RegGetValueA(
+				_root,
+				key,
+				valueName,
+				RRF_RT_REG_BINARY,
+				&type,
+				data.data(),
+				&dataSize
+			);
+			if (s == ERROR_MORE_DATA) {
+				// value outgrew the buffer, dataSize now holds the required size
+				_readRetries++;
+				data.resize(dataSize);
+				s = ::RegGetValueA(
+					_root,
+					key,
+					valueName,
+					RRF_RT_REG_BINARY,
+					&type,
+					data.data(),
+					&dataSize
+				);
+			}
+			if (s != ERROR_SUCCESS || dataSize == 0) {
+				data.clear();
+				return false;
+			}
+			data.resize(dataSize);
+			return true;
+		}
+
+		const bool RegistryStore::write(const LPCSTR subKey, const LPCSTR valueName, const uint8_t* data, const size_t size)
+		{
+			const std::string prefixed = _prefix.empty() ? std::string() : getSubKey(subKey);
+			const LSTATUS s = ::RegSetKeyValueA(
+				_root,
+				_prefix.empty() ? subKey : prefixed.c_str(),
+				valueName,
+				REG_BINARY,
+				data,
+				static_cast<DWORD>(size)
+			);
+			return (s == ERROR_SUCCESS);
+		}
+
+		std::unique_ptr<Watcher> RegistryStore::createWatcher(const LPCSTR valueName) const
+		{
+			UNREFERENCED_PARAMETER(valueName);
+			return std::make_unique<RegistryWatcher>(_root, _prefix);
+		}
+
+#pragma endregion RegistryStore
+#endif // _WIN32
+
+
+#pragma region MemoryStore
+
+		static const std::string makeValuePath(const LPCSTR subKey, const LPCSTR valueName)
+		{
+			return std::string(subKey) + "\\" + valueName;
+		}
+
+		static const int compareKeys(const LPCSTR subKeyA, const LPCSTR valueNameA, const LPCSTR subKeyB, const LPCSTR valueNameB) noexcept
+		{
+			const int subKey = std::strcmp(subKeyA, subKeyB);
+			return subKey != 0 ? subKey : std::strcmp(valueNameA, valueNameB);
+		}
+
+		const bool MemoryStore::KeyLess::operator()(const Key& a, const Key& b) const noexcept
+		{
+			return compareKeys(a.first.c_str(), a.second.c_str(), b.first.c_str(), b.second.c_str()) < 0;
+		}
+
+		const bool MemoryStore::KeyLess::operator()(const Key& a, const KeyView& b) const noexcept
+		{
+			return compareKeys(a.first.c_str(), a.second.c_str(), b.first, b.second) < 0;
+		}
+
+		const bool MemoryStore::KeyLess::operator()(const KeyView& a, const Key& b) const noexcept
+		{
+			return compareKeys(a.first, a.second, b.first.c_str(), b.second.c_str()) < 0;
+		}
+
+		const bool MemoryStore::read(const LPCSTR subKey, const LPCSTR valueName, std::vector<uint8_t>& data)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			const auto value = _values.find(KeyView(subKey, valueName));
+			if (value == _values.end())
+				return false;
+			data.assign(value->second.begin(), value->second.end());
+			return true;
+		}
+
+		const bool MemoryStore::write(const LPCSTR subKey, const LPCSTR valueName, const uint8_t* data, const size_t size)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			// only the first write of a value allocates its key, later ones reuse the stored vector's capacity
+			auto value = _values.find(KeyView(subKey, valueName));
+			if (value == _values.end())
+				value = _values.emplace(Key(subKey, valueName), std::vector<uint8_t>()).first;
+			value->second.assign(data, data + size);
+			return true;
+		}
+
+#pragma endregion MemoryStore
+
+
+#pragma region FileStore
+
+		const std::string FileStore::getPath(const LPCSTR subKey, const LPCSTR valueName) const
+		{
+			std::string name = makeValuePath(subKey, valueName);
+			for (char& c : name) {
+				switch (c)
+				{
+				case '\\': case '/': case ':': case '*': case '?': case '"': case '<': case '>': case '|':
+					c = '_';
+					break;
+				default:
+					break;
+				}
+			}
+			return _directory + "/" + name + ".bin";
+		}
+
+		const bool FileStore::read(const LPCSTR subKey, const LPCSTR valueName, std::vector<uint8_t>& data)
+		{
+			std::ifstream file(getPath(subKey, valueName), std::ios::binary);
+			if (!file)
+				return false;
+			data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			return !file.bad() && data.size() > 0;
+		}
+
+		const bool FileStore::write(const LPCSTR subKey, const LPCSTR valueName, const uint8_t* data, const size_t size)
+		{
+			// write aside then swap in so readers never see a partial value
+			const std::string path = getPath(subKey, valueName);
+			// a name of its own per process and thread, concurrent writers would truncate each other's file
+#ifdef _WIN32
+			const unsigned long process = ::GetCurrentProcessId();
+#else // _WIN32
+			const long process = static_cast<long>(::getpid());
+#endif // _WIN32
+			const std::string tmpPath = path + "." + std::to_string(process) + "."
+				+ std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+			bool written;
+			{
+				std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+				if (!file)
+					return false;
+				file.write(reinterpret_cast<const char*>(data), size);
+				written = static_cast<bool>(file);
+			}
+#ifdef _WIN32
+			written = written && ::MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else // _WIN32
+			written = written && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+#endif // _WIN32
+			if (!written)
+				std::remove(tmpPath.c_str()); // not left behind for every failed write
+			return written;
+		}
+
+		std::unique_ptr<Watcher> FileStore::createWatcher(const LPCSTR valueName) const
+		{
+			const FileStore store(_directory);
+			const std::string name(valueName);
+			return std::make_unique<FileWatcher>(_directory, [store, name](LPCSTR subKey) { return store.getPath(subKey, name.c_str()); });
+		}
+
+#pragma endregion FileStore
+
+
+		static std::shared_ptr<Store> makeDefaultStore()
+		{
+#ifdef _WIN32
+			return std::make_shared<RegistryStore>();
+#else // _WIN32
+			return std::make_shared<MemoryStore>();
+#endif // _WIN32
+		}
+
+		static std::shared_ptr<Store>& defaultStore()
+		{
+			static std::shared_ptr<Store> store = makeDefaultStore();
+			return store;
+		}
+
+		std::shared_ptr<Store> getDefaultStore()
+		{
+			return std::atomic_load(&defaultStore());
+		}
+
+		void setDefaultStore(const std::shared_ptr<Store>& store)
+		{
+			std::atomic_store(&defaultStore(), store ? store : makeDefaultStore());
+		}
+
+	} // namespace Registry
+} // namespace NightLightLibrary
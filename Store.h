@@ -0,0 +1,100 @@
+#pragma once
+#include "Platform.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		class Watcher;
+
+		// key/value backend behind Record<T>::load() and Record<T>::save()
+		// values are addressed by (subkey, value name) exactly like registry values
+		class Store
+		{
+		public:
+			virtual ~Store() {};
+			// replaces data with the stored bytes, returns false when the value is missing or unreadable
+			// data capacity is reused, callers should keep the same buffer between reads
+			virtual const bool read(const LPCSTR subKey, const LPCSTR valueName, std::vector<uint8_t>& data) = 0;
+			virtual const bool write(const LPCSTR subKey, const LPCSTR valueName, const uint8_t* data, const size_t size) = 0;
+			// watcher for valueName under the subkeys it is started on, nullptr when the store cannot be watched
+			virtual std::unique_ptr<Watcher> createWatcher(const LPCSTR valueName) const;
+		}; // class Store
+
+#ifdef _WIN32
+		// Win32 registry, values live under root (HKEY_CURRENT_USER by default)
+		// a prefix moves every subkey below it, like a user SID under HKEY_USERS
+		class RegistryStore : public Store
+		{
+		public:
+			RegistryStore(const HKEY root = HKEY_CURRENT_USER, const std::string& prefix = "") : _root(root), _prefix(prefix) {};
+			// store of a loaded profile hive under HKEY_USERS
+			static std::shared_ptr<RegistryStore> forProfile(const std::string& sid);
+			const HKEY getRoot() const noexcept { return _root; };
+			const std::string& getPrefix() const noexcept { return _prefix; };
+			// subKey as seen from root
+			const std::string getSubKey(const LPCSTR subKey) const;
+			const bool read(const LPCSTR subKey, const LPCSTR valueName, std::vector<uint8_t>& data) override;
+			const bool write(const LPCSTR subKey, const LPCSTR valueName, const uint8_t* data, const size_t size) override;
+			// notified on any change of the subkey, whatever the value
+			std::unique_ptr<Watcher> createWatcher(const LPCSTR valueName) const override;
+
+			// reads attempted
+			const uint64_t getReadCount() const noexcept { return _reads; };
+			// reads that did not fit the caller's buffer and needed a second RegGetValueA
+			const uint64_t getReadRetryCount() const noexcept { return _readRetries; };
+		private:
+			const HKEY _root;
+			const std::string _prefix;
+			std::atomic<uint64_t> _reads{ 0 };
+			std::atomic<uint64_t> _readRetries{ 0 };
+		}; // class RegistryStore
+#endif // _WIN32
+
+		// process-local values, starts empty
+		class MemoryStore : public Store
+		{
+		public:
+			const bool read(const LPCSTR subKey, const LPCSTR valueName, std::vector<uint8_t>& data) override;
+			const bool write(const LPCSTR subKey, const LPCSTR valueName, const uint8_t* data, const size_t size) override;
+		private:
+			// (subkey, value name), found from the caller's strings without copying them
+			typedef std::pair<std::string, std::string> Key;
+			typedef std::pair<LPCSTR, LPCSTR> KeyView;
+			struct KeyLess
+			{
+				typedef void is_transparent;
+				const bool operator()(const Key& a, const Key& b) const noexcept;
+				const bool operator()(const Key& a, const KeyView& b) const noexcept;
+				const bool operator()(const KeyView& a, const Key& b) const noexcept;
+			}; // struct KeyLess
+
+			std::mutex _mutex;
+			std::map<Key, std::vector<uint8_t>, KeyLess> _values;
+		}; // class MemoryStore
+
+		// one file per value in directory, named after the subkey and value name
+		class FileStore : public Store
+		{
+		public:
+			FileStore(const std::string& directory) : _directory(directory) {};
+			const std::string& getDirectory() const noexcept { return _directory; };
+			const std::string getPath(const LPCSTR subKey, const LPCSTR valueName) const;
+			const bool read(const LPCSTR subKey, const LPCSTR valueName, std::vector<uint8_t>& data) override;
+			const bool write(const LPCSTR subKey, const LPCSTR valueName, const uint8_t* data, const size_t size) override;
+			std::unique_ptr<Watcher> createWatcher(const LPCSTR valueName) const override;
+		private:
+			const std::string _directory;
+		}; // class FileStore
+
+		// store picked up by newly created records, a RegistryStore on Windows and a MemoryStore elsewhere
+		std::shared_ptr<Store> getDefaultStore();
+		void setDefaultStore(const std::shared_ptr<Store>& store);
+	} // namespace Registry
+} // namespace NightLightLibrary
@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "SunSchedule.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <mutex>
+
+namespace NightLightLibrary
+{
+	// locations kept by get(), one per user profile in practice
+	constexpr size_t SunScheduleCacheSize = 4;
+
+	constexpr double Pi = 3.14159265358979323846;
+	constexpr double Radians = Pi / 180.;
+	constexpr int MinutesPerDay = 24 * 60;
+	// sun center 50' below the horizon: refraction plus the solar radius
+	constexpr double SunriseZenith = 90.833 * Radians;
+
+	static const bool isLeapYear(const uint16_t year) noexcept
+	{
+		return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+	}
+
+	// local minus UTC in minutes at noon UTC of each day of the year
+	static void localOffsets(const uint16_t year, double* offsets) noexcept
+	{
+		SYSTEMTIME noon = { year, 1, 0, 1, 12, 0, 0, 0 };
+		FILETIME start;
+		if (!::SystemTimeToFileTime(&noon, &start)) {
+			std::fill(offsets, offsets + SunSchedule::Days, 0.);
+			return;
+		}
+		ULARGE_INTEGER utc;
+		utc.LowPart = start.dwLowDateTime;
+		utc.HighPart = start.dwHighDateTime;
+		for (size_t i = 0; i < SunSchedule::Days; i++, utc.QuadPart += 24ULL * 60 * 60 * 10'000'000) {
+			const FILETIME day = { utc.LowPart, utc.HighPart };
+			SYSTEMTIME utcTime, localTime;
+			offsets[i] = 0.;
+			if (::FileTimeToSystemTime(&day, &utcTime) && ::SystemTimeToTzSpecificLocalTime(NULL, &utcTime, &localTime))
+				offsets[i] = (localTime.wDay != utcTime.wDay ? (localTime.wHour < 12 ? MinutesPerDay : -MinutesPerDay) : 0)
+					+ (localTime.wHour - utcTime.wHour) * 60 + (localTime.wMinute - utcTime.wMinute);
+		}
+	}
+
+	static uint16_t toMinuteOfDay(const double minutes) noexcept
+	{
+		const long m = std::lround(minutes) % MinutesPerDay;
+		return static_cast<uint16_t>(m < 0 ? m + MinutesPerDay : m);
+	}
+
+	SunSchedule::SunSchedule(const double latitude, const double longitude, const uint16_t year)
+		: _latitude(latitude), _longitude(longitude), _year(year)
+	{
+		// structure of arrays and branch free loops, so the compiler vectorizes each pass over the year
+		double gamma[Days], eqtime[Days], declination[Days], cosHourAngle[Days], hourAngle[Days], offset[Days];
+
+		// fractional year at noon
+		const double yearLength = isLeapYear(year) ? 366. : 365.;
+		for (size_t i = 0; i < Days; i++)
+			gamma[i] = 2. * Pi / yearLength * i;
+
+		// equation of time in minutes and solar declination in radians
+		for (size_t i = 0; i < Days; i++) {
+			const double g = gamma[i];
+			eqtime[i] = 229.18 * (0.000075 + 0.001868 * std::cos(g) - 0.032077 * std::sin(g)
+				- 0.014615 * std::cos(2. * g) - 0.040849 * std::sin(2. * g));
+			declination[i] = 0.006918 - 0.399912 * std::cos(g) + 0.070257 * std::sin(g)
+				- 0.006758 * std::cos(2. * g) + 0.000907 * std::sin(2. * g)
+				- 0.002697 * std::cos(3. * g) + 0.00148 * std::sin(3. * g);
+		}
+
+		// hour angle of sunrise in degrees, its cosine leaves [-1, 1] on polar days (below) and nights (above)
+		// those take solar noon, an hour angle of 0
+		const double phi = latitude * Radians;
+		const double cosZenith = std::cos(SunriseZenith);
+		for (size_t i = 0; i < Days; i++) {
+			const double x = cosZenith / (std::cos(phi) * std::cos(declination[i])) - std::tan(phi) * std::tan(declination[i]);
+			cosHourAngle[i] = x;
+			hourAngle[i] = std::acos(std::abs(x) > 1. ? 1. : x) / Radians;
+		}
+
+		localOffsets(year, offset);
+		for (size_t i = 0; i < Days; i++) {
+			_table[i].sunrise = toMinuteOfDay(720. - 4. * (longitude + hourAngle[i]) - eqtime[i] + offset[i]);
+			_table[i].sunset = toMinuteOfDay(720. - 4. * (longitude - hourAngle[i]) - eqtime[i] + offset[i]);
+			_table[i].cycle = cosHourAngle[i] < -1. ? SunCycle::PolarDay
+				: cosHourAngle[i] > 1. ? SunCycle::PolarNight : SunCycle::Normal;
+		}
+	}
+
+	const size_t SunSchedule::dayOfYear(const SYSTEMTIME& date) noexcept
+	{
+		static constexpr uint16_t FirstDay[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+		const size_t month = std::min<size_t>(std::max<size_t>(date.wMonth, 1), 12) - 1;
+		const size_t leap = (month >= 2 && isLeapYear(date.wYear)) ? 1 : 0;
+		return std::min<size_t>(FirstDay[month] + leap + date.wDay - 1, Days - 1);
+	}
+
+	std::shared_ptr<const SunSchedule> SunSchedule::get(const double latitude, const double longitude, const uint16_t year)
+	{
+		static std::mutex mutex;
+		static std::deque<std::shared_ptr<const SunSchedule>> cache; // most recent first
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto it = cache.begin(); it != cache.end(); it++) {
+			if ((*it)->matches(latitude, longitude, year)) {
+				std::shared_ptr<const SunSchedule> schedule = *it;
+				cache.erase(it);
+				cache.push_front(schedule);
+				return schedule;
+			}
+		}
+		std::shared_ptr<const SunSchedule> schedule = std::make_shared<const SunSchedule>(latitude, longitude, year);
+		cache.push_front(schedule);
+		if (cache.size() > SunScheduleCacheSize)
+			cache.pop_back();
+		return schedule;
+	}
+} // namespace NightLightLibrary
@@ -0,0 +1,57 @@
+#pragma once
+#include "Platform.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+
+namespace NightLightLibrary
+{
+	// whether the sun rises and sets on a day
+	enum class SunCycle : uint8_t
+	{
+		Normal,
+		PolarDay,	// the sun never sets
+		PolarNight	// the sun never rises
+	}; // enum class SunCycle
+
+	// in minutes of the local day, both are solar noon on polar days and nights
+	struct SunTimes
+	{
+		uint16_t	sunrise;
+		uint16_t	sunset;
+		SunCycle	cycle;
+	}; // struct SunTimes
+
+	// sunrise and sunset for every day of a year at one location, using the NOAA solar equations
+	// the whole year is computed at once, lookups are a table read
+	class SunSchedule
+	{
+	public:
+		static constexpr size_t Days = 366;
+
+		// returns a cached table, building it on first use
+		static std::shared_ptr<const SunSchedule> get(const double latitude, const double longitude, const uint16_t year);
+		// index of the local date in the table
+		static const size_t dayOfYear(const SYSTEMTIME& date) noexcept;
+
+		// latitude north and longitude east in degrees, local times follow the system time zone
+		// days the sun does not rise or set are flagged by SunTimes::cycle
+		SunSchedule(const double latitude, const double longitude, const uint16_t year);
+
+		const bool matches(const double latitude, const double longitude, const uint16_t year) const noexcept
+		{
+			return _latitude == latitude && _longitude == longitude && _year == year;
+		}
+
+		// day 365 only exists in leap years, elsewhere it holds January 1st of the next year
+		const SunTimes& at(const size_t dayOfYear) const noexcept
+		{
+			return _table[dayOfYear < Days ? dayOfYear : Days - 1];
+		}
+	private:
+		const double	_latitude;
+		const double	_longitude;
+		const uint16_t	_year;
+		std::array<SunTimes, Days> _table;
+	}; // class SunSchedule
+} // namespace NightLightLibrary
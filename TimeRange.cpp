@@ -0,0 +1,80 @@
+#include "stdafx.h"
+#include "TimeRange.h"
+#include "Settings.h"
+#include <cassert>
+#include <cstring>
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NL_RANGE_SSE2
+#endif
+
+namespace NightLightLibrary
+{
+	constexpr int16_t MinutesPerDay = 24 * 60;
+
+	// a window is its start and its length past start, so wrapping needs no extra branch:
+	// t is within when (t - start) mod 1440 <= span
+	static int16_t span(const TimeWindow& window) noexcept
+	{
+		const int16_t d = static_cast<int16_t>(window.end - window.start);
+		return d < 0 ? d + MinutesPerDay : d;
+	}
+
+	static const bool isWithin(const uint16_t t, const TimeWindow& window, const int16_t span) noexcept
+	{
+		int16_t d = static_cast<int16_t>(t - window.start);
+		d += (d < 0) * MinutesPerDay;
+		return d <= span;
+	}
+
+	void isWithinRange(const uint16_t* minutes, const size_t count, const TimeWindow* windows, const size_t windowCount, uint64_t* mask) noexcept
+	{
+		std::memset(mask, 0, ((count + 63) / 64) * sizeof(uint64_t));
+		size_t i = 0;
+#ifdef NL_RANGE_SSE2
+		// 16 minutes per iteration, two registers of 8 int16 lanes packed into one 16 bit movemask
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i day = _mm_set1_epi16(MinutesPerDay);
+		for (; i + 16 <= count; i += 16) {
+			const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(minutes + i));
+			const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(minutes + i + 8));
+			__m128i outsideLow = _mm_cmpeq_epi16(zero, zero);
+			__m128i outsideHigh = outsideLow;
+			for (size_t w = 0; w < windowCount; w++) {
+				const __m128i start = _mm_set1_epi16(static_cast<short>(windows[w].start));
+				const __m128i length = _mm_set1_epi16(span(windows[w]));
+				__m128i dLow = _mm_sub_epi16(low, start);
+				__m128i dHigh = _mm_sub_epi16(high, start);
+				dLow = _mm_add_epi16(dLow, _mm_and_si128(_mm_cmplt_epi16(dLow, zero), day));
+				dHigh = _mm_add_epi16(dHigh, _mm_and_si128(_mm_cmplt_epi16(dHigh, zero), day));
+				outsideLow = _mm_and_si128(outsideLow, _mm_cmpgt_epi16(dLow, length));
+				outsideHigh = _mm_and_si128(outsideHigh, _mm_cmpgt_epi16(dHigh, length));
+			}
+			const uint64_t inside = static_cast<uint16_t>(~_mm_movemask_epi8(_mm_packs_epi16(outsideLow, outsideHigh)));
+			mask[i / 64] |= inside << (i % 64);
+		}
+#endif // NL_RANGE_SSE2
+		for (; i < count; i++) {
+			bool inside = false;
+			for (size_t w = 0; w < windowCount; w++)
+				inside |= isWithin(minutes[i], windows[w], span(windows[w]));
+			mask[i / 64] |= static_cast<uint64_t>(inside) << (i % 64);
+		}
+
+#ifdef _DEBUG
+		// the kernel must agree with the scalar Time implementation
+		for (size_t j = 0; j < count; j++) {
+			Time t;
+			t.setHours(static_cast<int8_t>(minutes[j] / 60)).setMinutes(static_cast<int8_t>(minutes[j] % 60));
+			bool expected = false;
+			for (size_t w = 0; w < windowCount; w++) {
+				Time start, end;
+				start.setHours(static_cast<int8_t>(windows[w].start / 60)).setMinutes(static_cast<int8_t>(windows[w].start % 60));
+				end.setHours(static_cast<int8_t>(windows[w].end / 60)).setMinutes(static_cast<int8_t>(windows[w].end % 60));
+				expected |= Time::isWithinRange(start, end, t);
+			}
+			assert(expected == (((mask[j / 64] >> (j % 64)) & 1) != 0));
+		}
+#endif // _DEBUG
+	}
+} // namespace NightLightLibrary
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace NightLightLibrary
+{
+	// minutes of day, end inclusive, wraps past midnight when end < start like Time::isWithinRange
+	struct TimeWindow
+	{
+		uint16_t	start;
+		uint16_t	end;
+	}; // struct TimeWindow
+
+	// bulk Time::isWithinRange over minutes of day in [0, 1440)
+	// sets bit i % 64 of mask[i / 64] when minutes[i] is within any of the windows, mask holds (count + 63) / 64 words
+	void isWithinRange(const uint16_t* minutes, const size_t count, const TimeWindow* windows, const size_t windowCount, uint64_t* mask) noexcept;
+} // namespace NightLightLibrary
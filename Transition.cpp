@@ -0,0 +1,67 @@
+#include "stdafx.h"
+#include "Transition.h"
+#include <cmath>
+#include <deque>
+#include <mutex>
+
+namespace NightLightLibrary
+{
+	// transitions kept by get(), dragging the temperature slider creates a new one per value
+	constexpr size_t TransitionCacheSize = 32;
+
+	// maps linear progress t in [0, 1] to eased progress
+	static const double ease(const TransitionCurve curve, const double t) noexcept
+	{
+		switch (curve)
+		{
+		case TransitionCurve::EaseInOut: // smoothstep
+			return t * t * (3. - 2. * t);
+		case TransitionCurve::SCurve: // smootherstep, flatter ends like the Windows transition
+			return t * t * t * (t * (t * 6. - 15.) + 10.);
+		default:
+			return t;
+		}
+	}
+
+	Transition::Transition(const int16_t from, const int16_t to, const ULONGLONG duration, const TransitionCurve curve) noexcept
+		: _from(from), _to(to), _duration(duration), _curve(curve)
+	{
+		// every curve but Linear interpolates in mired (1e6 / K), which is closer to perceived change
+		const bool inMired = (curve != TransitionCurve::Linear && from > 0 && to > 0);
+		const double start = inMired ? 1e6 / from : from;
+		const double end = inMired ? 1e6 / to : to;
+		for (size_t i = 0; i < Resolution; i++) {
+			const double value = start + (end - start) * ease(curve, i / static_cast<double>(Resolution - 1));
+			_table[i] = static_cast<int16_t>(std::lround(inMired ? 1e6 / value : value));
+		}
+	}
+
+	const size_t Transition::fill(int16_t* out, const size_t count, const ULONGLONG elapsed, const ULONGLONG step) const noexcept
+	{
+		size_t i = 0;
+		for (ULONGLONG t = elapsed; i < count && t < _duration; i++, t += step)
+			out[i] = interpolate(t);
+		return i;
+	}
+
+	std::shared_ptr<const Transition> Transition::get(const int16_t from, const int16_t to, const ULONGLONG duration, const TransitionCurve curve)
+	{
+		static std::mutex mutex;
+		static std::deque<std::shared_ptr<const Transition>> cache; // most recent first
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto it = cache.begin(); it != cache.end(); it++) {
+			if ((*it)->matches(from, to, duration, curve)) {
+				std::shared_ptr<const Transition> transition = *it;
+				cache.erase(it);
+				cache.push_front(transition);
+				return transition;
+			}
+		}
+		std::shared_ptr<const Transition> transition = std::make_shared<const Transition>(from, to, duration, curve);
+		cache.push_front(transition);
+		if (cache.size() > TransitionCacheSize)
+			cache.pop_back();
+		return transition;
+	}
+} // namespace NightLightLibrary
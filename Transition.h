@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <memory>
+#include "Platform.h"
+#include "NightLightWrapper.h"
+
+namespace NightLightLibrary
+{
+	// precomputed color temperature transition between two temperatures over a duration
+	// lookups are O(1) and integer only, tables are built once and shared through get()
+	class Transition
+	{
+	public:
+		static constexpr size_t Resolution = 256; // samples, first is "from", last is "to"
+
+		// returns a cached transition, building it on first use
+		static std::shared_ptr<const Transition> get(const int16_t from, const int16_t to, const ULONGLONG duration, const TransitionCurve curve);
+
+		Transition(const int16_t from, const int16_t to, const ULONGLONG duration, const TransitionCurve curve) noexcept;
+
+		const bool matches(const int16_t from, const int16_t to, const ULONGLONG duration, const TransitionCurve curve) const noexcept
+		{
+			return _from == from && _to == to && _duration == duration && _curve == curve;
+		}
+
+		const ULONGLONG getDuration() const noexcept { return _duration; }
+
+		// temperature elapsed ms into the transition
+		const int16_t at(const ULONGLONG elapsed) const noexcept
+		{
+			if (elapsed >= _duration)
+				return _to;
+			return interpolate(elapsed);
+		}
+
+		// fills out[i] with at(elapsed + i * step) while the transition runs
+		// returns the number of values written, frames past the end are left to the caller
+		const size_t fill(int16_t* out, const size_t count, const ULONGLONG elapsed, const ULONGLONG step) const noexcept;
+	private:
+		static constexpr unsigned int FractionBits = 16;
+
+		// linear between the two entries around elapsed, in 16.16 fixed point, elapsed < _duration
+		// elapsed * (Resolution - 1) << 16 stays far below 2^64 for any smoothening duration
+		const int16_t interpolate(const ULONGLONG elapsed) const noexcept
+		{
+			const ULONGLONG position = (elapsed * (Resolution - 1) << FractionBits) / _duration;
+			const size_t index = static_cast<size_t>(position >> FractionBits); // at most Resolution - 2
+			const int32_t fraction = static_cast<int32_t>(position & ((1u << FractionBits) - 1));
+			const int32_t delta = _table[index + 1] - _table[index];
+			return static_cast<int16_t>(_table[index] + ((delta * fraction + (1 << (FractionBits - 1))) >> FractionBits));
+		}
+
+		const int16_t			_from;
+		const int16_t			_to;
+		const ULONGLONG			_duration;
+		const TransitionCurve	_curve;
+		std::array<int16_t, Resolution> _table;
+	}; // class Transition
+} // namespace NightLightLibrary
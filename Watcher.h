@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Platform.h"
+
+namespace NightLightLibrary
+{
+	namespace Registry
+	{
+		// delays a key's callback until notifications stop for quietPeriod ms
+		// so a burst of writes results in a single callback
+		struct Coalescing
+		{
+			ULONGLONG	quietPeriod{ 0 };	// 0 calls back on every notification
+			ULONGLONG	maxDelay{ 0 };		// cap from the burst's first notification to the callback, 0 for none
+		}; // struct Coalescing
+
+		// change notifications for a set of record subkeys, created by Store::createWatcher()
+		class Watcher
+		{
+		public:
+			virtual ~Watcher() {};
+			virtual const bool isWatching() const noexcept = 0;
+			virtual void start(const std::vector<LPCSTR>& subKeys, const std::function<void(LPCSTR)>& callback) = 0;
+			virtual void stop() noexcept = 0;
+			virtual const bool isPaused() const noexcept = 0;
+			// notifications are dropped while paused
+			virtual void pause() noexcept = 0;
+			virtual void resume() noexcept = 0;
+			// applies to subkeys watched by the next start()
+			virtual void setCoalescing(const Coalescing& coalescing) noexcept = 0;
+			// calls back on the watching thread as soon as a change is seen, without coalescing, queueing or metrics
+			// for short non-blocking callbacks such as cache invalidation, applies from the next start()
+			virtual void setImmediate(const bool immediate) noexcept = 0;
+		}; // class Watcher
+
+		// FNV-1a, cheap enough to run on every notification
+		inline const uint64_t hashData(const uint8_t* data, const size_t size) noexcept
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < size; i++) {
+				hash ^= data[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		} // hashData()
+	} // namespace Registry
+} // namespace NightLightLibrary
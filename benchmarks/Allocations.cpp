@@ -0,0 +1,35 @@
+#include "Benchmark.h"
+#include <cstdlib>
+#include <new>
+
+// replaces the global operator new and delete so Benchmarks::run() can report allocations per iteration
+// kept out of Benchmark.h so the compiler does not pair the inlined malloc and free with new and delete
+namespace NightLightLibrary
+{
+	namespace Benchmarks
+	{
+		std::atomic<uint64_t>& allocations() noexcept
+		{
+			static std::atomic<uint64_t> count{ 0 };
+			return count;
+		}
+	} // namespace Benchmarks
+} // namespace NightLightLibrary
+
+void* operator new(std::size_t size)
+{
+	NightLightLibrary::Benchmarks::allocations().fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size != 0 ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
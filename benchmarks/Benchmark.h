@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+// the benchmarks are plain programs built like the tests, from their file and the library sources listed at its top
+// build them optimized, each prints one line per case with the mean time and allocations of an iteration
+// benchmarks/Allocations.cpp, in every benchmark's sources, replaces the global operator new to count allocations
+namespace NightLightLibrary
+{
+	namespace Benchmarks
+	{
+		// operator new calls so far
+		std::atomic<uint64_t>& allocations() noexcept;
+
+		// keeps the optimizer from dropping the work that produced value
+		inline void keep(const uint64_t value) noexcept
+		{
+			static volatile uint64_t sink = 0;
+			sink = sink + value;
+		}
+
+		// runs body iterations times after a tenth as many to warm up, returns ns per iteration
+		// allocations are counted process wide, the library's threads included
+		template<typename F> double run(const char* name, const size_t iterations, const F& body)
+		{
+			for (size_t i = 0; i < iterations / 10; i++)
+				body();
+			const uint64_t allocated = allocations();
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < iterations; i++)
+				body();
+			const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			const double mean = elapsed.count() / iterations;
+			const double allocationsPerIteration = static_cast<double>(allocations() - allocated) / iterations;
+			std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(12) << mean << " ns" << std::setprecision(2)
+				<< std::setw(10) << allocationsPerIteration << " allocs" << std::endl;
+			return mean;
+		}
+	} // namespace Benchmarks
+} // namespace NightLightLibrary
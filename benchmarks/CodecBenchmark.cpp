@@ -0,0 +1,84 @@
+// Settings and State encode and decode, the schema specific codec against bond's generic Compact Binary
+// sources: Settings.cpp State.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp benchmarks/Allocations.cpp
+#include "../Settings.h"
+#include "../State.h"
+#include "Benchmark.h"
+#include <string>
+
+using namespace NightLightLibrary;
+using namespace NightLightLibrary::Registry;
+
+constexpr size_t Iterations = 1'000'000;
+
+static void fill(Settings& settings, const uint16_t version)
+{
+	settings._reset();
+	settings._metadata.version = version;
+	settings.enabled = true;
+	settings.manualScheduleStartTime.hours = 21;
+	settings.manualScheduleStartTime.minutes = 30;
+	settings.manualScheduleEndTime.hours = 7;
+	settings.colorTemperature = 4000;
+}
+
+static void fill(State& state, const uint16_t version)
+{
+	state._reset();
+	state._metadata.version = version;
+	state.status.set_value() = Running;
+	state.trigger = Manual;
+	state.changedOn = 132'000'000'000'000'000ULL;
+}
+
+template<typename T> static void benchmark(const std::string& name, T& obj)
+{
+	const uint16_t version = obj._metadata.version;
+	const std::string prefix = name + " v" + std::to_string(version) + " ";
+
+	// the struct as marshal() writes it after the magic and version, what load() hands the codec
+	CompactBinary::Writer body(version);
+	Codec<T>::write(obj, body);
+	CompactBinary::Writer payload(version);
+	payload.writeStruct(body);
+
+	Benchmarks::run((prefix + "codec encode").c_str(), Iterations, [&]() {
+		CompactBinary::Writer writer(version);
+		Codec<T>::write(obj, writer);
+		Benchmarks::keep(writer.size());
+	});
+	T decoded;
+	Benchmarks::run((prefix + "codec decode").c_str(), Iterations, [&]() {
+		CompactBinary::Reader reader(payload.data(), payload.size(), version);
+		Benchmarks::keep(Codec<T>::read(reader, decoded._reset()));
+	});
+
+	OutputArena output;
+	Benchmarks::run((prefix + "bond encode").c_str(), Iterations, [&]() {
+		output.reset();
+		::bond::CompactBinaryWriter<OutputArena> writer(output, version);
+		::bond::Marshal(obj, writer);
+		Benchmarks::keep(output.size());
+	});
+	Benchmarks::run((prefix + "bond decode").c_str(), Iterations, [&]() {
+		unmarshal(::bond::InputBuffer(output.data(), static_cast<uint32_t>(output.size())), decoded._reset());
+		Benchmarks::keep(decoded._dirty);
+	});
+
+	// header, timestamp and metrics included, what every save pays before the write
+	Benchmarks::run((prefix + "marshal").c_str(), Iterations, [&]() {
+		Benchmarks::keep(marshal(obj));
+	});
+}
+
+int main()
+{
+	for (const uint16_t version : { ::bond::v1, ::bond::v2 }) {
+		Settings settings;
+		fill(settings, version);
+		benchmark("Settings", settings);
+		State state;
+		fill(state, version);
+		benchmark("State", state);
+	}
+	return 0;
+}
@@ -0,0 +1,46 @@
+// NightLightWrapper getters on the frame path, during a transition, on a MemoryStore
+// sources: NightLightWrapper.cpp Settings.cpp State.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp Executor.cpp Scheduler.cpp SunSchedule.cpp Transition.cpp GammaRamp.cpp TimeRange.cpp History.cpp benchmarks/Allocations.cpp
+#include "../NightLightWrapper.h"
+#include "../Settings.h"
+#include "../State.h"
+#include "Benchmark.h"
+
+using namespace NightLightLibrary;
+
+constexpr size_t Iterations = 1'000'000;
+
+int main()
+{
+	NightLightWrapper::useMemoryStore();
+	{
+		Settings settings;
+		settings._reset();
+		settings.setNightColorTemperature(3400);
+		settings.save();
+		State state;
+		state._reset();
+		state.setUsable(true);
+		state.save();
+	}
+	NightLightWrapper nl;
+	nl.enable().resume(); // starts the long transition
+	nl.setTransitionCurve(TransitionCurve::SCurve);
+
+	Benchmarks::run("getSmoothenedColorTemperature", Iterations, [&]() {
+		Benchmarks::keep(nl.getSmoothenedColorTemperature());
+	});
+	int16_t frames[60];
+	Benchmarks::run("getSmoothenedColorTemperatures, 60", Iterations / 10, [&]() {
+		nl.getSmoothenedColorTemperatures(frames, 60, 16);
+		Benchmarks::keep(frames[59]);
+	});
+	int16_t temperature = 3000;
+	Benchmarks::run("setNightColorTemperature", Iterations, [&]() {
+		temperature = temperature == 3000 ? 3001 : 3000;
+		nl.setNightColorTemperature(temperature);
+	});
+	Benchmarks::run("getVersion", Iterations, [&]() {
+		Benchmarks::keep(nl.getVersion());
+	});
+	return 0;
+}
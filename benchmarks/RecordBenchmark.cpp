@@ -0,0 +1,95 @@
+// Registry load and save of Settings and State against a MemoryStore, and the Settings and Time hot paths
+// sources: Settings.cpp State.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp benchmarks/Allocations.cpp
+#include "../Settings.h"
+#include "../State.h"
+#include "Benchmark.h"
+#include <memory>
+
+using namespace NightLightLibrary;
+
+constexpr size_t Iterations = 200'000;
+
+static void seed()
+{
+	Settings settings;
+	settings._reset();
+	settings.setNightColorTemperature(4000);
+	settings.save();
+	State state;
+	state._reset();
+	state.setUsable(true);
+	state.save();
+}
+
+static void benchmarkSettings()
+{
+	Settings settings;
+	Settings::load(settings);
+	Benchmarks::run("Settings load, unchanged", Iterations, [&]() {
+		Benchmarks::keep(Settings::refresh(settings) == Registry::LoadResult::Unchanged);
+	});
+	Benchmarks::run("Settings load, decoded", Iterations, [&]() {
+		settings._hashed = false;
+		Benchmarks::keep(Settings::refresh(settings) == Registry::LoadResult::Loaded);
+	});
+	Benchmarks::run("Settings save, identical", Iterations, [&]() {
+		settings._dirty = true;
+		Benchmarks::keep(settings.save()._dirty);
+	});
+	int16_t temperature = 3000;
+	Benchmarks::run("Settings save, changed", Iterations, [&]() {
+		temperature = temperature == 3000 ? 3001 : 3000;
+		settings.setNightColorTemperature(temperature);
+		Benchmarks::keep(settings.save()._dirty);
+	});
+	Benchmarks::run("Settings::setNightColorTemperature", Iterations * 10, [&]() {
+		temperature = temperature == 3000 ? 3001 : 3000;
+		Benchmarks::keep(settings.setNightColorTemperature(temperature)._dirty);
+	});
+}
+
+static void benchmarkState()
+{
+	State state;
+	State::load(state);
+	Benchmarks::run("State load, unchanged", Iterations, [&]() {
+		Benchmarks::keep(State::refresh(state) == Registry::LoadResult::Unchanged);
+	});
+	Benchmarks::run("State load, decoded", Iterations, [&]() {
+		state._hashed = false;
+		Benchmarks::keep(State::refresh(state) == Registry::LoadResult::Loaded);
+	});
+	bool running = false;
+	Benchmarks::run("State save, changed", Iterations, [&]() {
+		running = !running;
+		if (running)
+			state.resume();
+		else
+			state.pause();
+		Benchmarks::keep(Registry::Record<State>::save(state));
+	});
+}
+
+static void benchmarkTime()
+{
+	Time start, end, t;
+	start.setHours(21).setMinutes(0);
+	end.setHours(7).setMinutes(0);
+	uint16_t minute = 0;
+	Benchmarks::run("Time::isWithinRange", Iterations * 10, [&]() {
+		minute = static_cast<uint16_t>((minute + 7) % (24 * 60));
+		t.hours = static_cast<int8_t>(minute / 60);
+		t.minutes = static_cast<int8_t>(minute % 60);
+		Benchmarks::keep(Time::isWithinRange(start, end, t));
+	});
+}
+
+int main()
+{
+	Registry::setDefaultStore(std::make_shared<Registry::MemoryStore>());
+	seed();
+	benchmarkSettings();
+	benchmarkState();
+	benchmarkTime();
+	return 0;
+}
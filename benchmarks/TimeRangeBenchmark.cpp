@@ -0,0 +1,49 @@
+// bulk isWithinRange over a day of minutes against a Time::isWithinRange call per minute
+// sources: TimeRange.cpp Settings.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp benchmarks/Allocations.cpp
+#include "../TimeRange.h"
+#include "../Settings.h"
+#include "Benchmark.h"
+#include <vector>
+
+using namespace NightLightLibrary;
+
+constexpr size_t Iterations = 20'000;
+
+static Time toTime(const uint16_t minutes)
+{
+	Time t;
+	t.setHours(static_cast<int8_t>(minutes / 60)).setMinutes(static_cast<int8_t>(minutes % 60));
+	return t;
+}
+
+int main()
+{
+	std::vector<uint16_t> minutes;
+	for (uint16_t m = 0; m < 24 * 60; m++)
+		minutes.push_back(m);
+	const std::vector<TimeWindow> windows = { { 1260, 420 }, { 720, 780 } };
+	std::vector<uint64_t> mask((minutes.size() + 63) / 64);
+
+	Benchmarks::run("day, 2 windows, bulk", Iterations, [&]() {
+		isWithinRange(minutes.data(), minutes.size(), windows.data(), windows.size(), mask.data());
+		Benchmarks::keep(mask[0]);
+	});
+
+	std::vector<Time> times;
+	for (const uint16_t m : minutes)
+		times.push_back(toTime(m));
+	std::vector<std::pair<Time, Time>> ranges;
+	for (const TimeWindow& window : windows)
+		ranges.emplace_back(toTime(window.start), toTime(window.end));
+	Benchmarks::run("day, 2 windows, Time::isWithinRange", Iterations, [&]() {
+		uint64_t inside = 0;
+		for (const Time& t : times) {
+			bool within = false;
+			for (const std::pair<Time, Time>& range : ranges)
+				within |= Time::isWithinRange(range.first, range.second, t);
+			inside += within;
+		}
+		Benchmarks::keep(inside);
+	});
+	return 0;
+}
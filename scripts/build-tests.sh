@@ -0,0 +1,55 @@
+#!/bin/sh
+# builds tests/ and benchmarks/ outside Visual Studio, each program from its file and the sources listed on its "// sources:" line
+# usage: scripts/build-tests.sh [build directory] [--run]
+#   --run runs the tests once built, the benchmarks are only built
+#   CXX, CXXFLAGS, LDFLAGS	compiler, flags (bond and boost include paths) and libraries (the bond libraries when not header only)
+#   SCHEMA_DIR				directory holding the generated nightlight_schema_* files, generated into the build directory when unset
+#   GBC, PWSH				bond compiler and PowerShell used to generate them, as generate-schema-files.cmd does
+set -e
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+build=${1:-$root/build}
+run=
+[ "$2" = "--run" ] && run=1
+mkdir -p "$build"
+build=$(cd "$build" && pwd)
+
+CXX=${CXX:-c++}
+GBC=${GBC:-gbc}
+PWSH=${PWSH:-pwsh}
+
+# generate the schema files, unless given
+if [ -z "$SCHEMA_DIR" ]; then
+	SCHEMA_DIR=$build/schema
+	mkdir -p "$SCHEMA_DIR"
+	"$GBC" c++ --apply=compact --output-dir="$SCHEMA_DIR" "$root/nightlight_schema.bond"
+	"$PWSH" -NoProfile -File "$root/scripts/generate-schema-constants.ps1" "$root/nightlight_schema.bond" "$SCHEMA_DIR/nightlight_schema_constants.h"
+fi
+schemaSources=
+for f in nightlight_schema_types.cpp nightlight_schema_apply.cpp; do
+	[ -f "$SCHEMA_DIR/$f" ] && schemaSources="$schemaSources $SCHEMA_DIR/$f"
+done
+
+# the Scheduler waits on a Win32 waitable timer and is compiled out elsewhere
+windowsOnly="tests/SchedulerTest.cpp"
+
+failed=0
+cd "$root"
+for program in tests/*Test.cpp benchmarks/*Benchmark.cpp; do
+	case " $windowsOnly " in
+	*" $program "*)
+		echo "$program: skipped, Windows only"
+		continue
+		;;
+	esac
+	name=$(basename "$program" .cpp)
+	sources=$(grep -m1 '^// sources:' "$program" | sed 's#^// sources:##')
+	echo "$program"
+	$CXX -std=c++17 -O2 -I"$root" -I"$SCHEMA_DIR" $CXXFLAGS "$program" $sources $schemaSources -o "$build/$name" -lpthread $LDFLAGS
+	if [ -n "$run" ] && [ "${program#tests/}" != "$program" ] && ! "$build/$name"; then
+		failed=$((failed + 1))
+	fi
+done
+
+[ -n "$run" ] && echo "$failed test(s) failed"
+exit $failed
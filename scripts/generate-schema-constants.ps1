@@ -0,0 +1,106 @@
+# generates constexpr field ids, defaults, Min/Max bounds and registry subkeys from the bond schema
+# so the library does not have to query bond reflection metadata at runtime
+param(
+	[string]$Schema = "nightlight_schema.bond",
+	[string]$Output = "nightlight_schema_constants.h"
+)
+$ErrorActionPreference = "Stop"
+
+$scalarTypes = @{
+	"bool" = "bool";
+	"int8" = "int8_t"; "int16" = "int16_t"; "int32" = "int32_t"; "int64" = "int64_t";
+	"uint8" = "uint8_t"; "uint16" = "uint16_t"; "uint32" = "uint32_t"; "uint64" = "uint64_t"
+}
+$enums = @{}
+$namespace = $null
+$attributes = @{}
+$inEnum = $false
+$inStruct = $false
+$body = New-Object System.Collections.Generic.List[string]
+
+foreach ($raw in Get-Content $Schema) {
+	$line = ($raw -replace '\s//.*$', '').Trim()
+	if ($line -eq '' -or $line -eq '{') { continue }
+
+	if ($inEnum) {
+		if ($line -eq '}') { $inEnum = $false }
+		continue
+	}
+	if ($line -match '^namespace\s+([\w\.]+)\s*;') {
+		$namespace = $Matches[1] -replace '\.', '::'
+		continue
+	}
+	if ($line -match '^enum\s+(\w+)') {
+		$enums[$Matches[1]] = $true
+		$inEnum = $true
+		continue
+	}
+	if ($line -match '^\[(\w+)\("(.*)"\)\]$') {
+		$attributes[$Matches[1]] = $Matches[2]
+		continue
+	}
+	if ($line -match '^struct\s+(\w+)') {
+		$inStruct = $true
+		$body.Add("`tnamespace $($Matches[1])")
+		$body.Add("`t{")
+		if ($attributes.ContainsKey("RegistrySubkey")) {
+			# gbc copies attribute values into C++ literals after unescaping them once, do the same
+			$subkey = $attributes["RegistrySubkey"] -replace '\\\\', '\'
+			$body.Add("`t`tconstexpr const char* RegistrySubkey = `"$subkey`";")
+		}
+		$attributes = @{}
+		continue
+	}
+	if ($inStruct -and $line -eq '}') {
+		$body.Add("`t}")
+		$body.Add("")
+		$inStruct = $false
+		continue
+	}
+	if ($inStruct -and $line -match '^(\d+)\s*:\s*(?:(?:required|optional)\s+)?(\w+)\s+(\w+)\s*(?:=\s*(\w+))?\s*;') {
+		$id = $Matches[1]
+		$type = $Matches[2]
+		$name = $Matches[3]
+		$default = $Matches[4]
+		$body.Add("`t`tnamespace $name")
+		$body.Add("`t`t{")
+		$body.Add("`t`t`tconstexpr uint16_t Id = $id;")
+		if ($scalarTypes.ContainsKey($type)) {
+			$cppType = $scalarTypes[$type]
+			if (-not $default) { $default = if ($type -eq "bool") { "false" } else { "0" } }
+			$body.Add("`t`t`tconstexpr $cppType Default = $default;")
+			foreach ($bound in @("Min", "Max")) {
+				if ($attributes.ContainsKey($bound)) {
+					$body.Add("`t`t`tconstexpr $cppType $bound = $($attributes[$bound]);")
+				}
+			}
+		}
+		elseif ($enums.ContainsKey($type)) {
+			if ($default -eq "nothing") {
+				$body.Add("`t`t`tconstexpr bool DefaultIsNothing = true;")
+			}
+			elseif ($default) {
+				$body.Add("`t`t`tconstexpr bool DefaultIsNothing = false;")
+				$body.Add("`t`t`tconstexpr ${type} Default = ${type}::${default};")
+			}
+		}
+		$body.Add("`t`t}")
+		$attributes = @{}
+		continue
+	}
+}
+
+$header = New-Object System.Collections.Generic.List[string]
+$header.Add("// generated by scripts\generate-schema-constants.ps1 from $(Split-Path $Schema -Leaf), do not edit")
+$header.Add("#pragma once")
+$header.Add("#include `"nightlight_schema_types.h`"")
+$header.Add("")
+$header.Add("namespace $namespace")
+$header.Add("{")
+$header.Add("namespace Constants")
+$header.Add("{")
+$header.AddRange($body)
+$header.Add("} // namespace Constants")
+$header.Add("} // namespace $namespace")
+
+Set-Content -Path $Output -Value $header -Encoding Ascii
@@ -7,6 +7,9 @@ REM compile .bond file to c++
 REM call $(VcpkgRoot)tools\gbc.exe
 %2 c++ --apply=compact  nightlight_schema.bond
 
+REM generate constexpr schema constants (field ids, defaults, bounds, registry subkeys)
+powershell -NoProfile -ExecutionPolicy Bypass -File "%~dp0generate-schema-constants.ps1" nightlight_schema.bond nightlight_schema_constants.h
+
 REM prepend stdafx.h to bond schema .cpp files
 (echo #include "stdafx.h") > bond.cpp.tmp
 type nightlight_schema_apply.cpp >> bond.cpp.tmp
@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// the tests are plain programs, each built from its file and the library sources listed at its top
+// a failed check is printed, main() returns the number of failures
+namespace NightLightLibrary
+{
+	namespace Tests
+	{
+		inline int& failures() noexcept
+		{
+			static int count = 0;
+			return count;
+		}
+
+		inline void check(const bool passed, const char* expression, const char* file, const int line)
+		{
+			if (passed)
+				return;
+			failures()++;
+			std::cerr << file << "(" << line << "): check failed: " << expression << std::endl;
+		}
+
+		// polls condition until it holds or timeout ms have passed
+		inline const bool waitFor(const std::function<bool()>& condition, const int timeout = 2000)
+		{
+			const std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+			while (!condition()) {
+				if (std::chrono::steady_clock::now() >= until)
+					return false;
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+			return true;
+		}
+
+		inline int report(const char* name)
+		{
+			std::cout << name << ": " << (failures() == 0 ? "passed" : "FAILED") << std::endl;
+			return failures();
+		}
+	} // namespace Tests
+} // namespace NightLightLibrary
+
+#define CHECK(expression) NightLightLibrary::Tests::check((expression), #expression, __FILE__, __LINE__)
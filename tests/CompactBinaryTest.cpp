@@ -0,0 +1,255 @@
+// Settings and State against hand-encoded Compact Binary v1 and v2, both ways through a MemoryStore, and the data left to bond
+// sources: Settings.cpp State.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp
+#include "../Settings.h"
+#include "../State.h"
+#include "Check.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace NightLightLibrary;
+
+// bond data after the header, from the Compact Binary spec rather than the codec
+// a field starts with type | id << 5, ids above 5 as type | 6 << 5 then the id byte
+// int16 and int32 are zigzag varints, v2 prefixes each struct with its length
+static const std::vector<uint8_t> SettingsV1 = {
+	0x43, 0x42, 0x01, 0x00,				// COMPACT_PROTOCOL, v1
+	0x02, 0x01,							// 0 enabled: bool true
+	0xc2, 0x0a, 0x00,					// 10 onSunSchedule: bool false
+	0xca, 0x14,							// 20 manualScheduleStartTime: struct
+		0x0e, 0x15, 0x2e, 0x1e, 0x00,	// 0 hours: int8 21, 1 minutes: int8 30, stop
+	0xca, 0x1e,							// 30 manualScheduleEndTime: struct
+		0x0e, 0x07, 0x00,				// 0 hours: int8 7, minutes left at default, stop
+	0xcf, 0x28, 0xc0, 0x3e,				// 40 colorTemperature: int16 4000, zigzag 8000
+	0xca, 0x32, 0x00,					// 50 sunScheduleStartTime: empty struct
+	0xca, 0x3c, 0x00,					// 60 sunScheduleEndTime: empty struct
+	0xc2, 0x46, 0x01,					// 70 previewing: bool true
+	0x00								// stop
+};
+
+static const std::vector<uint8_t> SettingsV2 = {
+	0x43, 0x42, 0x02, 0x00,				// COMPACT_PROTOCOL, v2
+	0x23,								// 35 bytes
+	0x02, 0x01,
+	0xc2, 0x0a, 0x00,
+	0xca, 0x14,
+		0x05, 0x0e, 0x15, 0x2e, 0x1e, 0x00,
+	0xca, 0x1e,
+		0x03, 0x0e, 0x07, 0x00,
+	0xcf, 0x28, 0xc0, 0x3e,
+	0xca, 0x32,
+		0x01, 0x00,
+	0xca, 0x3c,
+		0x01, 0x00,
+	0xc2, 0x46, 0x01,
+	0x00
+};
+
+static const std::vector<uint8_t> StateV1 = {
+	0x43, 0x42, 0x01, 0x00,				// COMPACT_PROTOCOL, v1
+	0x10, 0x00,							// 0 status: int32 Running
+	0xd0, 0x0a, 0x02,					// 10 trigger: int32 Manual, zigzag 2
+	0xc6, 0x14, 0xac, 0x02,				// 20 changedOn: uint64 300
+	0xc2, 0x1e, 0x00,					// 30 usable: bool false
+	0x00								// stop
+};
+
+static const std::vector<uint8_t> StateV2 = {
+	0x43, 0x42, 0x02, 0x00,				// COMPACT_PROTOCOL, v2
+	0x0d,								// 13 bytes
+	0x10, 0x00,
+	0xd0, 0x0a, 0x02,
+	0xc6, 0x14, 0xac, 0x02,
+	0xc2, 0x1e, 0x00,
+	0x00
+};
+
+// data the codec leaves to bond: a field it does not know, a type it does not expect, another protocol
+static const std::vector<uint8_t> SettingsUnknownField = {
+	0x43, 0x42, 0x01, 0x00,				// COMPACT_PROTOCOL, v1
+	0x02, 0x01,							// 0 enabled: bool true
+	0xcf, 0x28, 0xc0, 0x3e,				// 40 colorTemperature: int16 4000
+	0xc2, 0x50, 0x01,					// 80: bool true, not in the schema
+	0x00								// stop
+};
+
+static const std::vector<uint8_t> SettingsUnexpectedType = {
+	0x43, 0x42, 0x01, 0x00,				// COMPACT_PROTOCOL, v1
+	0x02, 0x01,							// 0 enabled: bool true
+	0xce, 0x28, 0x64,					// 40 colorTemperature: int8 100 instead of int16
+	0x00								// stop
+};
+
+static const std::vector<uint8_t> SettingsFastBinary = {
+	0x4d, 0x46, 0x01, 0x00,				// FAST_PROTOCOL, v1
+	0x02, 0x00, 0x00, 0x01,				// 0 enabled: bool true, ids are uint16
+	0x0f, 0x28, 0x00, 0xa0, 0x0f,		// 40 colorTemperature: int16 4000, fixed width
+	0x00								// stop
+};
+
+static const std::vector<uint8_t> StateUnknownField = {
+	0x43, 0x42, 0x01, 0x00,				// COMPACT_PROTOCOL, v1
+	0x10, 0x00,							// 0 status: int32 Running
+	0xc2, 0x28, 0x01,					// 40: bool true, not in the schema
+	0x00								// stop
+};
+
+// a whole stored value, header included: h1, the FILETIME of the last write, h2
+static const std::vector<uint8_t> SettingsStored = {
+	0x02, 0x00, 0x00, 0x00,				// h1
+	0x00, 0xc0, 0x89, 0x76, 0x45, 0x3c, 0xda, 0x01,	// 2024-01-01 00:00 UTC
+	0x00, 0x00, 0x00, 0x00,				// h2
+	0x43, 0x42, 0x01, 0x00,
+	0x02, 0x01,
+	0xc2, 0x0a, 0x00,
+	0xca, 0x14,
+		0x0e, 0x15, 0x2e, 0x1e, 0x00,
+	0xca, 0x1e,
+		0x0e, 0x07, 0x00,
+	0xcf, 0x28, 0xc0, 0x3e,
+	0xca, 0x32, 0x00,
+	0xca, 0x3c, 0x00,
+	0xc2, 0x46, 0x01,
+	0x00
+};
+
+static Time makeTime(const int8_t hours, const int8_t minutes)
+{
+	Time time;
+	time._reset();
+	time.hours = hours;
+	time.minutes = minutes;
+	return time;
+}
+
+template<typename T> static const std::vector<uint8_t> stored(const std::shared_ptr<Registry::Store>& store)
+{
+	std::vector<uint8_t> data;
+	CHECK(store->read(T::getRegistryKey(), T::getRegistryValueName(), data));
+	if (data.size() < sizeof(Registry::Header))
+		return {};
+	return std::vector<uint8_t>(data.begin() + sizeof(Registry::Header), data.end());
+}
+
+template<typename T> static void put(const std::shared_ptr<Registry::Store>& store, const std::vector<uint8_t>& golden)
+{
+	std::vector<uint8_t> data(sizeof(Registry::Header), 0);
+	data.insert(data.end(), golden.begin(), golden.end());
+	CHECK(store->write(T::getRegistryKey(), T::getRegistryValueName(), data.data(), data.size()));
+}
+
+static void testSettings(const uint16_t version, const std::vector<uint8_t>& golden)
+{
+	const std::shared_ptr<Registry::Store> store = std::make_shared<Registry::MemoryStore>();
+	Settings settings;
+	settings.setStore(store)._reset();
+	settings._metadata.version = version;
+	settings.enabled = true;
+	settings.onSunSchedule = false;
+	settings.manualScheduleStartTime = makeTime(21, 30);
+	settings.manualScheduleEndTime = makeTime(7, 0);
+	settings.colorTemperature = 4000;
+	settings.previewing = true;
+	settings._dirty = true;
+	settings.save();
+	CHECK(stored<Settings>(store) == golden);
+
+	put<Settings>(store, golden);
+	Settings loaded;
+	loaded.setStore(store);
+	CHECK(Settings::load(loaded));
+	CHECK(loaded._metadata.version == version);
+	CHECK(loaded.enabled && !loaded.onSunSchedule && loaded.previewing);
+	CHECK(loaded.manualScheduleStartTime.hours == 21 && loaded.manualScheduleStartTime.minutes == 30);
+	CHECK(loaded.manualScheduleEndTime.hours == 7 && loaded.manualScheduleEndTime.minutes == 0);
+	CHECK(loaded.sunScheduleStartTime.hours == 0 && loaded.sunScheduleEndTime.minutes == 0);
+	CHECK(loaded.colorTemperature == 4000);
+
+	// saved back unchanged, the same bytes
+	loaded._dirty = true;
+	loaded.save();
+	CHECK(stored<Settings>(store) == golden);
+}
+
+static void testState(const uint16_t version, const std::vector<uint8_t>& golden)
+{
+	const std::shared_ptr<Registry::Store> store = std::make_shared<Registry::MemoryStore>();
+	State state;
+	state.setStore(store)._reset();
+	state._metadata.version = version;
+	state.status.set_value() = Running;
+	state.trigger = Manual;
+	state.changedOn = 300;
+	state.usable = false;
+	// through the record layer, State::save() stamps trigger and changedOn
+	state._dirty = true;
+	Registry::Record<State>::save(state);
+	CHECK(stored<State>(store) == golden);
+
+	put<State>(store, golden);
+	State loaded;
+	loaded.setStore(store);
+	CHECK(State::load(loaded));
+	CHECK(loaded._metadata.version == version);
+	CHECK(!loaded.status.is_nothing() && loaded.status.value() == Running);
+	CHECK(loaded.trigger == Manual);
+	CHECK(loaded.changedOn == 300);
+	CHECK(!loaded.usable);
+
+	loaded._dirty = true;
+	Registry::Record<State>::save(loaded);
+	CHECK(stored<State>(store) == golden);
+}
+
+template<typename T> static void testBondFallback(const std::vector<uint8_t>& data)
+{
+	const std::shared_ptr<Registry::Store> store = std::make_shared<Registry::MemoryStore>();
+	put<T>(store, data);
+	const uint64_t bondDecodes = Registry::Record<T>::_metrics().bondDecodes;
+	T loaded;
+	loaded.setStore(store);
+	Registry::load(loaded);
+	// decoded by bond whether or not bond accepts the data, the codec gave up on it
+	CHECK(Registry::Record<T>::_metrics().bondDecodes == bondDecodes + 1);
+}
+
+static void testStoredValue()
+{
+	// the header read is written back, only its timestamp changes
+	const std::shared_ptr<Registry::Store> store = std::make_shared<Registry::MemoryStore>();
+	CHECK(store->write(Settings::getRegistryKey(), Settings::getRegistryValueName(), SettingsStored.data(), SettingsStored.size()));
+	const uint64_t bondDecodes = Registry::Record<Settings>::_metrics().bondDecodes;
+	Settings loaded;
+	loaded.setStore(store);
+	CHECK(Settings::load(loaded));
+	CHECK(Registry::Record<Settings>::_metrics().bondDecodes == bondDecodes);
+	CHECK(loaded._header.h1 == 2 && loaded._header.h2 == 0);
+	CHECK(loaded.enabled && loaded.colorTemperature == 4000);
+	CHECK(loaded.manualScheduleStartTime.hours == 21 && loaded.manualScheduleStartTime.minutes == 30);
+
+	loaded._dirty = true;
+	Registry::Record<Settings>::save(loaded); // identical data, skipped
+	loaded.setNightColorTemperature(4000)._dirty = true;
+	loaded.previewing = false;
+	loaded.save();
+	std::vector<uint8_t> data;
+	CHECK(store->read(Settings::getRegistryKey(), Settings::getRegistryValueName(), data));
+	CHECK(data.size() > sizeof(Registry::Header));
+	CHECK(std::equal(data.begin(), data.begin() + 4, SettingsStored.begin()));
+	CHECK(std::equal(data.begin() + 12, data.begin() + 16, SettingsStored.begin() + 12));
+	CHECK(!std::equal(data.begin() + 4, data.begin() + 12, SettingsStored.begin() + 4));
+}
+
+int main()
+{
+	testSettings(::bond::v1, SettingsV1);
+	testSettings(::bond::v2, SettingsV2);
+	testState(::bond::v1, StateV1);
+	testState(::bond::v2, StateV2);
+	testStoredValue();
+	testBondFallback<Settings>(SettingsUnknownField);
+	testBondFallback<Settings>(SettingsUnexpectedType);
+	testBondFallback<Settings>(SettingsFastBinary);
+	testBondFallback<State>(StateUnknownField);
+	return Tests::report("CompactBinaryTest");
+}
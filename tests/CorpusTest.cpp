@@ -0,0 +1,68 @@
+// Corpus capture and read, truncated and oversized entries included
+// sources: Corpus.cpp
+#include "../Corpus.h"
+#include "Check.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace NightLightLibrary;
+
+static void append(const std::string& path, const uint16_t subKeySize, const uint32_t dataSize, const std::string& content)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::app);
+	file.write(reinterpret_cast<const char*>(&subKeySize), sizeof(subKeySize));
+	file.write(reinterpret_cast<const char*>(&dataSize), sizeof(dataSize));
+	file.write(content.data(), content.size());
+}
+
+static void capture(const std::string& path)
+{
+	std::filesystem::remove(path);
+	CHECK(Registry::Corpus::startCapture(path.c_str()));
+	const uint8_t data[] = { 1, 2, 3 };
+	Registry::Corpus::capture("Key", data, sizeof(data));
+	Registry::Corpus::capture("Other", data, 0);
+	Registry::Corpus::stopCapture();
+}
+
+static void testRoundTrip(const std::string& path)
+{
+	capture(path);
+	std::vector<Registry::Corpus::Entry> entries;
+	CHECK(Registry::Corpus::read(path.c_str(), entries));
+	CHECK(entries.size() == 2);
+	CHECK(entries.size() == 2 && entries[0].subKey == "Key" && entries[0].data == std::vector<uint8_t>({ 1, 2, 3 }));
+	CHECK(entries.size() == 2 && entries[1].subKey == "Other" && entries[1].data.empty());
+}
+
+static void testTruncated(const std::string& path)
+{
+	// the last entry claims more data than the file holds
+	capture(path);
+	append(path, 3, 10, "Keyabc");
+	std::vector<Registry::Corpus::Entry> entries;
+	CHECK(!Registry::Corpus::read(path.c_str(), entries));
+	CHECK(entries.size() == 2);
+}
+
+static void testOversized(const std::string& path)
+{
+	// rejected before anything is allocated for it
+	capture(path);
+	append(path, 0xffff, 0xffffffff, "Key");
+	std::vector<Registry::Corpus::Entry> entries;
+	CHECK(!Registry::Corpus::read(path.c_str(), entries));
+	CHECK(entries.size() == 2);
+}
+
+int main()
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "NightLightCorpusTest.bin").string();
+	testRoundTrip(path);
+	testTruncated(path);
+	testOversized(path);
+	std::filesystem::remove(path);
+	return Tests::report("CorpusTest");
+}
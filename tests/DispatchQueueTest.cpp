@@ -0,0 +1,100 @@
+// DispatchQueue overflow policies and shutdown
+// sources: DispatchQueue.cpp Metrics.cpp
+#include "../DispatchQueue.h"
+#include "Check.h"
+#include <atomic>
+#include <vector>
+
+using namespace NightLightLibrary;
+
+// keeps the callback thread busy until released
+class Blocker
+{
+public:
+	explicit Blocker(Registry::DispatchQueue& queue)
+	{
+		queue.post([this]() {
+			_running = true;
+			while (!_released)
+				std::this_thread::yield();
+		});
+		Tests::waitFor([this]() { return _running.load(); });
+	}
+	~Blocker() { release(); }
+	void release() noexcept { _released = true; }
+private:
+	std::atomic<bool> _running{ false };
+	std::atomic<bool> _released{ false };
+}; // class Blocker
+
+static void testDropOldest(Registry::DispatchQueue& queue)
+{
+	// every post either runs or is counted as dropped
+	queue.setOverflow(Registry::Overflow::DropOldest);
+	const uint64_t dropped = queue.getDroppedCount();
+	std::atomic<uint64_t> ran{ 0 };
+	std::vector<std::thread> producers;
+	for (int t = 0; t < 4; t++) {
+		producers.emplace_back([&queue, &ran]() {
+			for (int i = 0; i < 20000; i++)
+				queue.post([&ran]() { ran++; });
+		});
+	}
+	for (std::thread& producer : producers)
+		producer.join();
+	CHECK(Tests::waitFor([&]() { return queue.getDepth() == 0; }));
+	CHECK(ran + queue.getDroppedCount() - dropped == 80000);
+	CHECK(queue.getMaxDepth() <= Registry::DispatchQueue::Capacity + 4);
+}
+
+static void testCoalescePerKey(Registry::DispatchQueue& queue)
+{
+	queue.setOverflow(Registry::Overflow::CoalescePerKey);
+	std::atomic<bool> queued{ false };
+	std::atomic<int> ran{ 0 };
+	{
+		Blocker blocker(queue);
+		for (int i = 0; i < 50; i++)
+			queue.post([&ran]() { ran++; }, &queued);
+		CHECK(queued);
+	}
+	CHECK(Tests::waitFor([&]() { return ran == 1; }));
+	CHECK(!queued);
+	// posted again once the merged one started
+	queue.post([&ran]() { ran++; }, &queued);
+	CHECK(Tests::waitFor([&]() { return ran == 2; }));
+}
+
+static void testShutdown(Registry::DispatchQueue& queue)
+{
+	// queued tasks are discarded rather than run, what they reach may already be destroyed
+	std::atomic<int> ran{ 0 };
+	std::atomic<bool> queued{ false };
+	Blocker blocker(queue);
+	queue.post([&ran]() { ran++; });
+	queue.post([&ran]() { ran++; }, &queued);
+	// shutdown() flags the queue at once, then waits for the running task
+	std::thread shutdown([&queue]() { queue.shutdown(); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	blocker.release();
+	shutdown.join();
+	CHECK(ran == 0);
+	CHECK(queue.getDepth() == 0);
+	CHECK(!queued);
+
+	// and later posts are dropped
+	queue.post([&ran]() { ran++; });
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(ran == 0);
+	CHECK(queue.getDepth() == 0);
+}
+
+int main()
+{
+	Registry::DispatchQueue& queue = Registry::DispatchQueue::instance();
+	CHECK(!Registry::DispatchQueue::isCallbackThread());
+	testDropOldest(queue);
+	testCoalescePerKey(queue);
+	testShutdown(queue);
+	return Tests::report("DispatchQueueTest");
+}
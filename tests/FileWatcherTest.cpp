@@ -0,0 +1,166 @@
+// FileStore change notifications, through inotify where available and through polling, and concurrent writes
+// sources: Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp
+#include "../Store.h"
+#include "../FileWatcher.h"
+#include "../DispatchQueue.h"
+#include "../Metrics.h"
+#include "Check.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NightLightLibrary;
+
+static void write(Registry::FileStore& store, const char* content)
+{
+	store.write("Key", "Value", reinterpret_cast<const uint8_t*>(content), strlen(content));
+}
+
+static void testNotified(const std::string& directory)
+{
+	Registry::FileStore store(directory);
+	write(store, "one");
+	std::atomic<int> callbacks{ 0 };
+	std::string subKey;
+	Registry::FileWatcher watcher(directory, [&store](LPCSTR key) { return store.getPath(key, "Value"); });
+	watcher.start({ "Key" }, [&](LPCSTR key) { subKey = key; callbacks++; });
+	CHECK(watcher.isWatching());
+#ifdef __linux__
+	CHECK(watcher.isNotified());
+#endif // __linux__
+
+	write(store, "two");
+	CHECK(Tests::waitFor([&]() { return callbacks == 1; }));
+	CHECK(subKey == "Key");
+
+	// rewritten with the same content, the metadata moves but nothing is reported
+	write(store, "two");
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	CHECK(callbacks == 1);
+
+	watcher.pause();
+	write(store, "three");
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	watcher.resume();
+	CHECK(callbacks == 1);
+
+	write(store, "four");
+	CHECK(Tests::waitFor([&]() { return callbacks == 2; }));
+
+	watcher.stop();
+	CHECK(!watcher.isWatching());
+	write(store, "five");
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	CHECK(callbacks == 2);
+}
+
+static void testCoalesced(const std::string& directory)
+{
+	Registry::FileStore store(directory);
+	write(store, "0");
+	std::atomic<int> callbacks{ 0 };
+	Registry::FileWatcher watcher(directory, [&store](LPCSTR key) { return store.getPath(key, "Value"); });
+	watcher.setCoalescing({ 150, 0 });
+	watcher.start({ "Key" }, [&](LPCSTR) { callbacks++; });
+	const char* burst[] = { "1", "2", "3", "4", "5" };
+	for (const char* content : burst) {
+		write(store, content);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	CHECK(Tests::waitFor([&]() { return callbacks == 1; }));
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	CHECK(callbacks == 1);
+}
+
+static void testImmediate(const std::string& directory)
+{
+	// called back on the watcher thread, and left out of the metrics
+	Registry::FileStore store(directory);
+	write(store, "0");
+	std::atomic<int> callbacks{ 0 };
+	std::atomic<bool> queued{ true };
+	Registry::FileWatcher watcher(directory, [&store](LPCSTR key) { return store.getPath(key, "Value"); });
+	watcher.setCoalescing({ 1000, 0 });
+	watcher.setImmediate(true);
+	watcher.start({ "Key" }, [&](LPCSTR) { queued = Registry::DispatchQueue::isCallbackThread(); callbacks++; });
+	const uint64_t fileCallbacks = Metrics::watch().fileCallbacks;
+	const uint64_t fileWakeups = Metrics::watch().fileWakeups;
+	write(store, "1");
+	// not held back by the quiet period
+	CHECK(Tests::waitFor([&]() { return callbacks == 1; }, 500));
+	CHECK(!queued);
+	CHECK(watcher.getCallbackCount() == 1);
+	CHECK(Metrics::watch().fileCallbacks == fileCallbacks);
+	CHECK(Metrics::watch().fileWakeups == fileWakeups);
+}
+
+static void testPolled(const std::string& directory)
+{
+	// a directory missing at start cannot be watched by inotify, the watcher falls back to polling
+	Registry::FileStore store(directory);
+	std::atomic<int> callbacks{ 0 };
+	Registry::FileWatcher watcher(directory, [&store](LPCSTR key) { return store.getPath(key, "Value"); }, { 10, 40 });
+	watcher.start({ "Key" }, [&](LPCSTR) { callbacks++; });
+	CHECK(!watcher.isNotified());
+
+	std::filesystem::create_directories(directory);
+	write(store, "created");
+	CHECK(Tests::waitFor([&]() { return callbacks == 1; }));
+
+	std::filesystem::remove_all(directory);
+	CHECK(Tests::waitFor([&]() { return callbacks == 2; }));
+}
+
+static void testConcurrentWrites(const std::string& directory)
+{
+	// each writer swaps in a whole value of its own, none fails on another's temporary file
+	Registry::FileStore store(directory);
+	const std::vector<std::string> contents{ "a", "bb", "ccc", "dddd" };
+	std::atomic<int> failures{ 0 };
+	std::vector<std::thread> writers;
+	for (const std::string& content : contents) {
+		writers.emplace_back([&store, &failures, content]() {
+			for (int i = 0; i < 200; i++) {
+				if (!store.write("Key", "Value", reinterpret_cast<const uint8_t*>(content.data()), content.size()))
+					failures++;
+			}
+		});
+	}
+	for (std::thread& writer : writers)
+		writer.join();
+	CHECK(failures == 0);
+
+	std::vector<uint8_t> data;
+	CHECK(store.read("Key", "Value", data));
+	const std::string stored(data.begin(), data.end());
+	CHECK(std::find(contents.begin(), contents.end(), stored) != contents.end());
+	size_t files = 0;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory)) {
+		UNREFERENCED_PARAMETER(entry);
+		files++;
+	}
+	CHECK(files == 1); // no temporary file left
+}
+
+int main()
+{
+	const std::filesystem::path root = std::filesystem::temp_directory_path() / "NightLightFileWatcherTest";
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root / "notified");
+	std::filesystem::create_directories(root / "coalesced");
+	std::filesystem::create_directories(root / "immediate");
+	std::filesystem::create_directories(root / "concurrent");
+
+	testNotified((root / "notified").string());
+	testCoalesced((root / "coalesced").string());
+	testImmediate((root / "immediate").string());
+	testPolled((root / "polled").string());
+	testConcurrentWrites((root / "concurrent").string());
+
+	std::filesystem::remove_all(root);
+	return Tests::report("FileWatcherTest");
+}
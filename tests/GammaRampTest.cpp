@@ -0,0 +1,48 @@
+// GammaRamp cache keys and size
+// sources: GammaRamp.cpp Transition.cpp
+#include "../GammaRamp.h"
+#include "../Transition.h"
+#include "nightlight_schema_constants.h"
+#include "Check.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace NightLightLibrary;
+namespace ct = Constants::_Settings::colorTemperature;
+
+static void testClamped()
+{
+	// out of range temperatures share the ramp of their bound
+	CHECK(GammaRamp::get(ct::Min - 100) == GammaRamp::get(ct::Min));
+	CHECK(GammaRamp::get(ct::Max + 100) == GammaRamp::get(ct::Max));
+	CHECK(GammaRamp::get(ct::Min) != GammaRamp::get(ct::Max));
+}
+
+static void testTransitionCached()
+{
+	// every entry of a transition table stays cached while it is replayed
+	const Transition transition(ct::Max, ct::Min, Transition::Resolution - 1, TransitionCurve::Linear);
+	std::vector<std::shared_ptr<const GammaRamp>> ramps;
+	for (ULONGLONG elapsed = 0; elapsed < Transition::Resolution; elapsed++)
+		ramps.push_back(GammaRamp::get(transition.at(elapsed)));
+	for (ULONGLONG elapsed = 0; elapsed < Transition::Resolution; elapsed++)
+		CHECK(GammaRamp::get(transition.at(elapsed)) == ramps[elapsed]);
+}
+
+static void testRamp()
+{
+	const GammaRamp ramp = GammaRamp::fromColorTemperature(ct::Default);
+	for (size_t i = 0; i < GammaRamp::Size; i++)
+		CHECK(ramp.red[i] == i * 257 && ramp.green[i] == i * 257 && ramp.blue[i] == i * 257);
+	const GammaRamp night = GammaRamp::fromColorTemperature(ct::Min - 100);
+	CHECK(std::memcmp(GammaRamp::get(ct::Min).get(), &night, sizeof(GammaRamp)) == 0);
+}
+
+int main()
+{
+	testClamped();
+	testTransitionCached();
+	testRamp();
+	return Tests::report("GammaRampTest");
+}
@@ -0,0 +1,132 @@
+// History ring appends across a wrap, and reopening an existing file with the same or another capacity
+// sources: History.cpp
+#include "../History.h"
+#include "Check.h"
+#include <filesystem>
+#include <string>
+
+using namespace NightLightLibrary;
+
+constexpr uint32_t Capacity = 4;
+
+static void append(History& history, const uint64_t count)
+{
+	for (uint64_t i = 0; i < count; i++) {
+		const uint64_t index = history.getHead();
+		history.append(static_cast<int16_t>(3000 + index), HistoryFlag::Enabled, 1000 + index);
+	}
+}
+
+// the record for index holds what append() above wrote for it
+static const bool holds(const History& history, const uint64_t index)
+{
+	const HistoryRecord* record = history.at(index);
+	if (record == nullptr)
+		return false;
+	const bool matches = record->colorTemperature == 3000 + static_cast<int16_t>(index)
+		&& record->flags == HistoryFlag::Enabled && record->timestamp == 1000 + index;
+	return matches && history.isCurrent(index, record);
+}
+
+static void testWrap(const std::string& path)
+{
+	std::filesystem::remove(path);
+	const std::shared_ptr<History> history = History::open(path.c_str(), Capacity);
+	CHECK(history != nullptr);
+	if (!history)
+		return;
+	CHECK(history->getCapacity() == Capacity);
+	CHECK(history->getHead() == 0 && history->getTail() == 0);
+	CHECK(history->at(0) == nullptr);
+
+	append(*history, 3);
+	CHECK(history->getHead() == 3 && history->getTail() == 0);
+	for (uint64_t i = 0; i < 3; i++)
+		CHECK(holds(*history, i));
+
+	// index 1 is read, then overwritten by index 5
+	const HistoryRecord* record = history->at(1);
+	append(*history, 3);
+	CHECK(history->getHead() == 6 && history->getTail() == 2);
+	CHECK(history->at(0) == nullptr);
+	CHECK(history->at(1) == nullptr);
+	CHECK(record != nullptr && !history->isCurrent(1, record));
+	for (uint64_t i = 2; i < 6; i++)
+		CHECK(holds(*history, i));
+	CHECK(history->at(6) == nullptr);
+}
+
+static void testReopen(const std::string& path)
+{
+	std::filesystem::remove(path);
+	{
+		const std::shared_ptr<History> history = History::open(path.c_str(), Capacity);
+		CHECK(history != nullptr);
+		if (history)
+			append(*history, 6);
+	}
+
+	// the same capacity keeps the records
+	{
+		const std::shared_ptr<History> history = History::open(path.c_str(), Capacity);
+		CHECK(history != nullptr);
+		if (history) {
+			CHECK(history->getHead() == 6);
+			for (uint64_t i = 2; i < 6; i++)
+				CHECK(holds(*history, i));
+			append(*history, 1);
+		}
+	}
+	{
+		const std::shared_ptr<History> history = History::open(path.c_str(), 0, true);
+		CHECK(history != nullptr);
+		if (history) {
+			CHECK(history->getCapacity() == Capacity && history->getHead() == 7);
+			CHECK(holds(*history, 6));
+		}
+	}
+
+	// a smaller capacity starts over once, the larger file is then kept as is
+	{
+		const std::shared_ptr<History> history = History::open(path.c_str(), Capacity / 2);
+		CHECK(history != nullptr);
+		if (history) {
+			CHECK(history->getCapacity() == Capacity / 2 && history->getHead() == 0);
+			append(*history, 3);
+		}
+	}
+	{
+		const std::shared_ptr<History> history = History::open(path.c_str(), Capacity / 2);
+		CHECK(history != nullptr);
+		if (history) {
+			CHECK(history->getHead() == 3);
+			CHECK(holds(*history, 1) && holds(*history, 2));
+		}
+	}
+
+	// a larger one starts over too
+	{
+		const std::shared_ptr<History> history = History::open(path.c_str(), Capacity * 2);
+		CHECK(history != nullptr);
+		if (history)
+			CHECK(history->getCapacity() == Capacity * 2 && history->getHead() == 0);
+	}
+}
+
+static void testFailure(const std::string& directory)
+{
+	CHECK(History::open((directory + "/missing/NightLightHistory.bin").c_str(), Capacity) == nullptr);
+	CHECK(History::open((directory + "/NightLightHistoryMissing.bin").c_str(), 0, true) == nullptr);
+	CHECK(History::open((directory + "/NightLightHistoryMissing.bin").c_str(), 0) == nullptr);
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	const std::string path = (directory / "NightLightHistoryTest.bin").string();
+	testWrap(path);
+	testReopen(path);
+	testFailure(directory.string());
+	std::filesystem::remove(path);
+	return Tests::report("HistoryTest");
+}
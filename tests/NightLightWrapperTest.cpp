@@ -0,0 +1,63 @@
+// NightLightWrapper on a MemoryStore
+// sources: NightLightWrapper.cpp Settings.cpp State.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp Executor.cpp Scheduler.cpp SunSchedule.cpp Transition.cpp GammaRamp.cpp TimeRange.cpp History.cpp
+#include "../NightLightWrapper.h"
+#include "../Settings.h"
+#include "../State.h"
+#include "Check.h"
+#include <filesystem>
+#include <string>
+
+using namespace NightLightLibrary;
+
+static void seed()
+{
+	Settings settings;
+	settings._reset();
+	settings.setNightColorTemperature(4000);
+	settings.save();
+	State state;
+	state._reset();
+	state.setUsable(true);
+	state.save();
+}
+
+static void testRestoreAfterExternalWrite()
+{
+	// restore() writes the backup back even though the wrapper's records already held the same data
+	NightLightWrapper nl;
+	CHECK(nl.getNightColorTemperature() == 4000);
+
+	Settings other;
+	CHECK(Settings::load(other));
+	other.setNightColorTemperature(5000).save();
+
+	nl.restore();
+	Settings stored;
+	CHECK(Settings::load(stored));
+	CHECK(stored.getNightColorTemperature() == 4000);
+	CHECK(nl.getNightColorTemperature() == 4000);
+}
+
+static void testRecording()
+{
+	NightLightWrapper nl;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	const std::string path = (directory / "NightLightWrapperTest.history").string();
+	CHECK(nl.startRecording(path.c_str(), 16));
+	CHECK(nl.isRecording());
+	// a file that cannot be created is reported, the running recording goes on
+	CHECK(!nl.startRecording((directory / "missing" / "NightLightWrapperTest.history").string().c_str(), 16));
+	CHECK(nl.isRecording());
+	nl.stopRecording();
+	CHECK(!nl.isRecording());
+	std::filesystem::remove(path);
+}
+
+int main()
+{
+	NightLightWrapper::useMemoryStore();
+	seed();
+	testRestoreAfterExternalWrite();
+	testRecording();
+	return Tests::report("NightLightWrapperTest");
+}
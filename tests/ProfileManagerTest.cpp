@@ -0,0 +1,164 @@
+// ProfileManager over one MemoryStore per profile, failing and throwing profiles included
+// sources: ProfileManager.cpp Settings.cpp State.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp
+#include "../ProfileManager.h"
+#include "Check.h"
+#include <atomic>
+#include <map>
+#include <stdexcept>
+
+using namespace NightLightLibrary;
+
+// a MemoryStore counting writes, whose reads or writes can be made to fail
+class TestStore : public Registry::MemoryStore
+{
+public:
+	std::atomic<bool>		failReads{ false };
+	std::atomic<bool>		failWrites{ false };
+	std::atomic<uint64_t>	writes{ 0 };
+
+	const bool read(const LPCSTR subKey, const LPCSTR valueName, std::vector<uint8_t>& data) override
+	{
+		return !failReads && MemoryStore::read(subKey, valueName, data);
+	}
+	const bool write(const LPCSTR subKey, const LPCSTR valueName, const uint8_t* data, const size_t size) override
+	{
+		writes++;
+		return !failWrites && MemoryStore::write(subKey, valueName, data, size);
+	}
+}; // class TestStore
+
+static std::map<std::string, std::shared_ptr<TestStore>> makeStores(const std::vector<std::string>& profiles)
+{
+	std::map<std::string, std::shared_ptr<TestStore>> stores;
+	for (const std::string& profile : profiles) {
+		const std::shared_ptr<TestStore> store = std::make_shared<TestStore>();
+		Settings settings;
+		settings.setStore(store)._reset();
+		settings.setNightColorTemperature(4000).save();
+		State state;
+		state.setStore(store)._reset();
+		state.setUsable(true).save();
+		store->writes = 0;
+		stores[profile] = store;
+	}
+	return stores;
+}
+
+static ProfileManager::StoreFactory factoryOf(const std::map<std::string, std::shared_ptr<TestStore>>& stores)
+{
+	return [stores](const std::string& profile) -> std::shared_ptr<Registry::Store> {
+		const auto found = stores.find(profile);
+		if (found == stores.end())
+			throw std::runtime_error("unknown profile");
+		return found->second;
+	};
+}
+
+static const int16_t storedTemperature(const std::shared_ptr<Registry::Store>& store)
+{
+	Settings settings;
+	settings.setStore(store);
+	CHECK(Settings::load(settings));
+	return settings.getNightColorTemperature();
+}
+
+static void testConcurrentRun()
+{
+	// more profiles than threads, each one changed once, at most as many at a time as threads
+	std::vector<std::string> profiles;
+	for (int i = 0; i < 12; i++)
+		profiles.push_back("S-1-5-21-" + std::to_string(i));
+	const std::map<std::string, std::shared_ptr<TestStore>> stores = makeStores(profiles);
+	const ProfileManager manager(profiles, 3, factoryOf(stores));
+
+	std::atomic<int> running{ 0 };
+	std::atomic<int> mostRunning{ 0 };
+	std::atomic<int> calls{ 0 };
+	const std::vector<ProfileReport> reports = manager.run([&](const std::string&, Settings& settings, State&) {
+		const int now = ++running;
+		for (int most = mostRunning; now > most && !mostRunning.compare_exchange_weak(most, now);)
+			;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		settings.setNightColorTemperature(3000);
+		calls++;
+		running--;
+	});
+
+	CHECK(calls == 12);
+	CHECK(mostRunning >= 1 && mostRunning <= 3);
+	CHECK(reports.size() == profiles.size());
+	for (size_t i = 0; i < reports.size() && i < profiles.size(); i++) {
+		// in the order of the profiles, whichever worker ran them
+		CHECK(reports[i].profile == profiles[i]);
+		CHECK(reports[i].loaded && reports[i].saved && !reports[i].failed);
+		CHECK(storedTemperature(stores.at(profiles[i])) == 3000);
+	}
+}
+
+static void testFailingStores()
+{
+	const std::vector<std::string> profiles{ "readable", "unreadable", "unwritable" };
+	const std::map<std::string, std::shared_ptr<TestStore>> stores = makeStores(profiles);
+	stores.at("unreadable")->failReads = true;
+	stores.at("unwritable")->failWrites = true;
+	const ProfileManager manager(profiles, 2, factoryOf(stores));
+
+	const std::vector<ProfileReport> reports = manager.run([](const std::string&, Settings& settings, State&) {
+		settings.setNightColorTemperature(3500);
+	});
+	CHECK(reports.size() == 3);
+	if (reports.size() != 3)
+		return;
+	CHECK(reports[0].loaded && reports[0].saved);
+	CHECK(!reports[1].loaded && !reports[1].saved);
+	CHECK(stores.at("unreadable")->writes == 0);
+	CHECK(reports[2].loaded && !reports[2].saved);
+	CHECK(stores.at("unwritable")->writes > 0);
+	for (const ProfileReport& report : reports)
+		CHECK(!report.failed);
+}
+
+static void testThrowing()
+{
+	// a throwing factory or changes fail their profile only
+	const std::vector<std::string> profiles{ "first", "missing", "throwing", "last" };
+	const std::map<std::string, std::shared_ptr<TestStore>> stores = makeStores({ "first", "throwing", "last" });
+	const ProfileManager manager(profiles, 2, factoryOf(stores));
+
+	const std::vector<ProfileReport> reports = manager.run([](const std::string& profile, Settings& settings, State&) {
+		if (profile == "throwing")
+			throw std::runtime_error("changes failed");
+		settings.setNightColorTemperature(3200);
+	});
+	CHECK(reports.size() == 4);
+	if (reports.size() != 4)
+		return;
+	CHECK(reports[0].saved && !reports[0].failed);
+	CHECK(reports[1].failed && !reports[1].loaded && !reports[1].saved);
+	CHECK(reports[2].failed && reports[2].loaded && !reports[2].saved);
+	CHECK(stores.at("throwing")->writes == 0);
+	CHECK(reports[3].saved && !reports[3].failed);
+}
+
+static void testLoadSavesNothing()
+{
+	const std::vector<std::string> profiles{ "a", "b", "c", "d", "e" };
+	const std::map<std::string, std::shared_ptr<TestStore>> stores = makeStores(profiles);
+	const ProfileManager manager(profiles, 2, factoryOf(stores));
+
+	const std::vector<ProfileReport> reports = manager.load();
+	CHECK(reports.size() == profiles.size());
+	for (const ProfileReport& report : reports)
+		CHECK(report.loaded && !report.saved && !report.failed);
+	for (const auto& store : stores)
+		CHECK(store.second->writes == 0);
+}
+
+int main()
+{
+	testConcurrentRun();
+	testFailingStores();
+	testThrowing();
+	testLoadSavesNothing();
+	return Tests::report("ProfileManagerTest");
+}
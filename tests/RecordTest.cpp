@@ -0,0 +1,153 @@
+// Record loads and saves against a MemoryStore, saves skipped only when the store already holds the data
+// sources: Settings.cpp State.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp benchmarks/Allocations.cpp
+#include "../Settings.h"
+#include "../State.h"
+#include "Check.h"
+#include "../benchmarks/Benchmark.h"
+#include <filesystem>
+
+using namespace NightLightLibrary;
+
+static void seed()
+{
+	Settings settings;
+	settings._reset();
+	settings.setNightColorTemperature(4000);
+	settings.save();
+	CHECK(!settings._dirty);
+	State state;
+	state._reset();
+	state.setUsable(true);
+	state.save();
+	CHECK(!state._dirty);
+}
+
+static const int16_t storedTemperature()
+{
+	Settings settings;
+	CHECK(Settings::load(settings));
+	return settings.getNightColorTemperature();
+}
+
+static void testIdenticalSave()
+{
+	// nothing changed anywhere, the write is skipped
+	Settings settings;
+	CHECK(Settings::load(settings));
+	const uint64_t skipped = Settings::getSkippedSaveCount();
+	settings._dirty = true;
+	settings.save();
+	CHECK(!settings._dirty);
+	CHECK(Settings::getSkippedSaveCount() == skipped + 1);
+}
+
+static void testSaveAfterExternalWrite()
+{
+	// a backup saves what it loaded, which no longer is what the store holds
+	Settings backup;
+	CHECK(Settings::load(backup));
+	Settings other;
+	CHECK(Settings::load(other));
+	other.setNightColorTemperature(5000).save();
+	CHECK(storedTemperature() == 5000);
+
+	const uint64_t skipped = Settings::getSkippedSaveCount();
+	backup._dirty = true;
+	backup.save();
+	CHECK(Settings::getSkippedSaveCount() == skipped);
+	CHECK(storedTemperature() == 4000);
+}
+
+static void testStateSaveAfterExternalWrite()
+{
+	State backup;
+	CHECK(State::load(backup));
+	CHECK(!backup.isRunning());
+	State other;
+	CHECK(State::load(other));
+	other.resume().save();
+
+	backup._dirty = true;
+	backup.save();
+	State stored;
+	CHECK(State::load(stored));
+	CHECK(!stored.isRunning());
+}
+
+static void testArenaReused()
+{
+	// sized by the first save, later saves of the record reuse it
+	Settings settings;
+	CHECK(Settings::load(settings));
+	settings.setNightColorTemperature(3000).save();
+	const uint64_t grows = settings._writeBuffer.getGrowCount();
+	CHECK(grows > 0);
+	for (int16_t temperature = 3001; temperature < 3100; temperature++)
+		settings.setNightColorTemperature(temperature).save();
+	CHECK(storedTemperature() == 3099);
+	CHECK(settings._writeBuffer.getGrowCount() == grows);
+}
+
+static void testCodecTimed()
+{
+	// encodes take well under a microsecond, counted in nanoseconds they still register
+	const Metrics::Histogram::Snapshot encode = Registry::Record<Settings>::_metrics().encode.snapshot();
+	CHECK(encode.count > 0);
+	CHECK(encode.total > 0);
+	CHECK(encode.buckets[0] < encode.count);
+}
+
+static void testSaveAllocationFree()
+{
+	// once the record and the store hold the value, saving it again allocates nothing
+	Settings settings;
+	CHECK(Settings::load(settings));
+	settings.setNightColorTemperature(3000).save();
+	settings.setNightColorTemperature(3001).save();
+	const uint64_t allocated = Benchmarks::allocations();
+	for (int i = 0; i < 100; i++) {
+		settings.setNightColorTemperature(i % 2 == 0 ? 3000 : 3001).save();
+		settings._dirty = true;
+		settings.save(); // identical, skipped
+	}
+	CHECK(Benchmarks::allocations() == allocated);
+	CHECK(storedTemperature() == 3001);
+}
+
+static void testCacheFollowsStore()
+{
+	// a MemoryStore cannot be watched, its records are not asked to share again until setStore()
+	Settings settings;
+	CHECK(Settings::load(settings));
+	CHECK(settings._cacheLooked && !settings._cache);
+	settings.setNightColorTemperature(3500).save();
+	CHECK(settings._cacheLooked && !settings._cache);
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "NightLightRecordTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	{
+		Settings watched;
+		watched.setStore(std::make_shared<Registry::FileStore>(directory.string().c_str()));
+		CHECK(!watched._cacheLooked);
+		watched.setNightColorTemperature(3600)._dirty = true;
+		watched.save();
+		CHECK(Settings::load(watched));
+		CHECK(watched._cacheLooked && watched._cache);
+	}
+	std::filesystem::remove_all(directory);
+}
+
+int main()
+{
+	Registry::setDefaultStore(std::make_shared<Registry::MemoryStore>());
+	seed();
+	testIdenticalSave();
+	testSaveAfterExternalWrite();
+	testStateSaveAfterExternalWrite();
+	testArenaReused();
+	testCodecTimed();
+	testSaveAllocationFree();
+	testCacheFollowsStore();
+	return Tests::report("RecordTest");
+}
@@ -0,0 +1,68 @@
+// Scheduler events for empty, daytime, overnight and whole-day schedules
+// sources: Scheduler.cpp
+#include "../Scheduler.h"
+#include "Check.h"
+
+using namespace NightLightLibrary;
+
+constexpr ULONGLONG FileTimeMinute = 60ULL * 10'000'000; // 100 ns units
+
+static ULONGLONG now()
+{
+	FILETIME filetime;
+	::GetSystemTimeAsFileTime(&filetime);
+	ULARGE_INTEGER value;
+	value.LowPart = filetime.dwLowDateTime;
+	value.HighPart = filetime.dwHighDateTime;
+	return value.QuadPart;
+}
+
+static void testEmpty()
+{
+	// start == end fires nothing, like a disabled schedule
+	Scheduler scheduler([](const ScheduleEvent) {}, 0);
+	ScheduleEvent event;
+	ULONGLONG due;
+	for (const uint16_t minute : { 0, 600, 1439 }) {
+		scheduler.reschedule(true, minute, minute);
+		CHECK(!scheduler.getNext(event, due));
+	}
+	scheduler.reschedule(false, 600, 660);
+	CHECK(!scheduler.getNext(event, due));
+}
+
+static void testWindows()
+{
+	// the next event is a Start or an End within a day, 25 hours across a daylight saving change
+	Scheduler scheduler([](const ScheduleEvent) {}, 0);
+	ScheduleEvent event;
+	ULONGLONG due;
+	for (const auto& window : { std::make_pair(600, 601), std::make_pair(1260, 420), std::make_pair(1439, 0) }) {
+		const ULONGLONG before = now();
+		scheduler.reschedule(true, static_cast<uint16_t>(window.first), static_cast<uint16_t>(window.second));
+		CHECK(scheduler.getNext(event, due));
+		CHECK(event == ScheduleEvent::Start || event == ScheduleEvent::End);
+		CHECK(due > before && due <= before + 25 * 60 * FileTimeMinute);
+	}
+}
+
+static void testWholeDay()
+{
+	// ending the minute before it starts, only Start fires
+	Scheduler scheduler([](const ScheduleEvent) {}, 0);
+	ScheduleEvent event;
+	ULONGLONG due;
+	for (const auto& window : { std::make_pair(0, 1439), std::make_pair(600, 599) }) {
+		scheduler.reschedule(true, static_cast<uint16_t>(window.first), static_cast<uint16_t>(window.second));
+		CHECK(scheduler.getNext(event, due));
+		CHECK(event == ScheduleEvent::Start);
+	}
+}
+
+int main()
+{
+	testEmpty();
+	testWindows();
+	testWholeDay();
+	return Tests::report("SchedulerTest");
+}
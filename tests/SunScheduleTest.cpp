@@ -0,0 +1,55 @@
+// SunSchedule tables at mid and high latitudes, polar days and nights included
+// sources: SunSchedule.cpp
+#include "../SunSchedule.h"
+#include "Check.h"
+
+using namespace NightLightLibrary;
+
+constexpr size_t January1 = 0;
+constexpr size_t March21 = 79;
+constexpr size_t June21 = 171;
+constexpr size_t December21 = 354;
+
+static const int nightLength(const SunTimes& sun)
+{
+	return (sun.sunrise - sun.sunset + 24 * 60) % (24 * 60);
+}
+
+static void testMidLatitude()
+{
+	// Oslo, the sun rises and sets every day
+	const SunSchedule schedule(59.91, 10.75, 2025);
+	for (size_t day = 0; day < SunSchedule::Days; day++)
+		CHECK(schedule.at(day).cycle == SunCycle::Normal);
+	CHECK(nightLength(schedule.at(June21)) < nightLength(schedule.at(March21)));
+	CHECK(nightLength(schedule.at(March21)) < nightLength(schedule.at(December21)));
+}
+
+static void testArctic()
+{
+	// Tromso, polar night from late November to mid January, midnight sun from late May to late July
+	const SunSchedule schedule(69.65, 18.96, 2025);
+	CHECK(schedule.at(January1).cycle == SunCycle::PolarNight);
+	CHECK(schedule.at(December21).cycle == SunCycle::PolarNight);
+	CHECK(schedule.at(June21).cycle == SunCycle::PolarDay);
+	CHECK(schedule.at(March21).cycle == SunCycle::Normal);
+	// both take solar noon, the same minute
+	CHECK(schedule.at(January1).sunrise == schedule.at(January1).sunset);
+	CHECK(schedule.at(June21).sunrise == schedule.at(June21).sunset);
+}
+
+static void testAntarctic()
+{
+	// McMurdo, the seasons are swapped
+	const SunSchedule schedule(-77.85, 166.67, 2025);
+	CHECK(schedule.at(January1).cycle == SunCycle::PolarDay);
+	CHECK(schedule.at(June21).cycle == SunCycle::PolarNight);
+}
+
+int main()
+{
+	testMidLatitude();
+	testArctic();
+	testAntarctic();
+	return Tests::report("SunScheduleTest");
+}
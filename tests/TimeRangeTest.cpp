@@ -0,0 +1,53 @@
+// bulk isWithinRange against Time::isWithinRange for every minute of the day
+// sources: TimeRange.cpp Settings.cpp Registry.cpp Store.cpp FileWatcher.cpp DispatchQueue.cpp Metrics.cpp Corpus.cpp
+#include "../TimeRange.h"
+#include "../Settings.h"
+#include "Check.h"
+#include <vector>
+
+using namespace NightLightLibrary;
+
+static Time toTime(const uint16_t minutes)
+{
+	Time t;
+	t.setHours(static_cast<int8_t>(minutes / 60)).setMinutes(static_cast<int8_t>(minutes % 60));
+	return t;
+}
+
+static void check(const std::vector<uint16_t>& minutes, const std::vector<TimeWindow>& windows)
+{
+	std::vector<uint64_t> mask((minutes.size() + 63) / 64, ~0ULL);
+	isWithinRange(minutes.data(), minutes.size(), windows.data(), windows.size(), mask.data());
+	size_t mismatches = 0;
+	for (size_t i = 0; i < minutes.size(); i++) {
+		bool expected = false;
+		for (const TimeWindow& window : windows)
+			expected |= Time::isWithinRange(toTime(window.start), toTime(window.end), toTime(minutes[i]));
+		mismatches += expected != (((mask[i / 64] >> (i % 64)) & 1) != 0);
+	}
+	CHECK(mismatches == 0);
+}
+
+int main()
+{
+	// every minute, a count that leaves a scalar tail after the 16 wide blocks
+	std::vector<uint16_t> day;
+	for (uint16_t m = 0; m < 24 * 60; m++)
+		day.push_back(m);
+	day.push_back(0);
+	day.push_back(1439);
+	day.push_back(720);
+
+	check(day, { { 0, 0 } });			// a single minute
+	check(day, { { 600, 600 } });
+	check(day, { { 0, 1439 } });		// the whole day
+	check(day, { { 480, 1020 } });		// daytime
+	check(day, { { 1260, 420 } });		// wraps past midnight
+	check(day, { { 1439, 0 } });		// wraps over midnight only
+	check(day, { { 1260, 420 }, { 720, 780 } });
+	check(day, {});						// nothing is within no window
+
+	// fewer minutes than a block
+	check({ 5, 1000, 1439 }, { { 1000, 5 } });
+	return Tests::report("TimeRangeTest");
+}
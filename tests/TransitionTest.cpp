@@ -0,0 +1,44 @@
+// Transition lookups interpolate between table entries and fill() agrees with at()
+// sources: Transition.cpp
+#include "../Transition.h"
+#include "Check.h"
+#include <cstdlib>
+
+using namespace NightLightLibrary;
+
+static void testLinear()
+{
+	// a linear transition is a straight line, between table entries too
+	const ULONGLONG duration = 120'000;
+	const Transition transition(6500, 3500, duration, TransitionCurve::Linear);
+	CHECK(transition.at(0) == 6500);
+	CHECK(transition.at(duration) == 3500);
+	int maxError = 0;
+	int16_t previous = transition.at(0);
+	for (ULONGLONG elapsed = 0; elapsed < duration; elapsed += 7) {
+		const int16_t value = transition.at(elapsed);
+		const int expected = 6500 - static_cast<int>((3000 * elapsed + duration / 2) / duration);
+		maxError = std::max(maxError, std::abs(value - expected));
+		CHECK(value <= previous);
+		previous = value;
+	}
+	// the floor index alone is off by up to one step, 3000 / 255 K
+	CHECK(maxError <= 1);
+}
+
+static void testFill()
+{
+	const Transition transition(3400, 6500, 2'000, TransitionCurve::SCurve);
+	int16_t frames[200];
+	const size_t filled = transition.fill(frames, 200, 5, 16);
+	CHECK(filled == 125);
+	for (size_t i = 0; i < filled; i++)
+		CHECK(frames[i] == transition.at(5 + i * 16));
+}
+
+int main()
+{
+	testLinear();
+	testFill();
+	return Tests::report("TransitionTest");
+}